@@ -1,10 +1,28 @@
+#include "config.h"
+
 #include "bmc_dump_entry.hpp"
 
+#include "dump_digest.hpp"
 #include "dump_manager.hpp"
 #include "dump_offload.hpp"
+#include "dump_store.hpp"
 #include "dump_utils.hpp"
 
+#include <systemd/sd-event.h>
+#include <unistd.h>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <phosphor-logging/elog-errors.hpp>
+#include <phosphor-logging/elog.hpp>
 #include <phosphor-logging/lg2.hpp>
+#include <xyz/openbmc_project/Common/error.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <system_error>
+#include <vector>
 
 namespace phosphor
 {
@@ -13,18 +31,21 @@ namespace dump
 namespace bmc
 {
 
+using namespace phosphor::logging;
+
+/** @brief Number of bytes read from the dump per digest update */
+constexpr auto digestChunkSize = 128 * 1024;
+
+/** @brief Suffix of the digest file dreport writes next to an archive */
+constexpr auto digestSuffix = ".sha256";
+
+/** @brief Length of a hex encoded SHA-256 digest */
+constexpr size_t digestLength = 64;
+
 void Entry::delete_()
 {
-    // Delete Dump file from Permanent location
-    try
-    {
-        std::filesystem::remove_all(file.parent_path());
-    }
-    catch (const std::filesystem::filesystem_error& e)
-    {
-        // Log Error message and continue
-        lg2::error("Failed to delete dump file, errormsg: {ERROR}", "ERROR", e);
-    }
+    // The manager moves the dump files to its trash when the entry is erased,
+    // they are removed in the background.
 #ifdef LOG_PEL_ON_DUMP_ACTIONS
     auto bus = sdbusplus::bus::new_default();
     // Log PEL for dump delete
@@ -37,10 +58,254 @@ void Entry::delete_()
     phosphor::dump::Entry::delete_();
 }
 
+Entry::DigestState::DigestState(const std::filesystem::path& file) :
+    reader(file), buffer(digestChunkSize)
+{}
+
+void Entry::updateDigest()
+{
+    stopDigest();
+
+    // dreport leaves the digest of the archive in .<archive name>.sha256
+    auto digestFile =
+        file.parent_path() / ("." + file.filename().string() + digestSuffix);
+    std::ifstream in(digestFile);
+    std::string value;
+    if (in >> value)
+    {
+        in.close();
+        std::error_code ec;
+        std::filesystem::remove(digestFile, ec);
+        if ((value.size() == digestLength) &&
+            std::ranges::all_of(value, [](char c) {
+                return std::isxdigit(static_cast<unsigned char>(c));
+            }))
+        {
+            digest(value);
+            algorithm(HashAlgorithm::SHA256);
+            return;
+        }
+        lg2::error("Invalid dump digest, ID: {ID}, FILENAME: {FILENAME}", "ID",
+                   id, "FILENAME", digestFile);
+    }
+
+    try
+    {
+        digestState = std::make_unique<DigestState>(file);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to compute the dump digest, errormsg: {ERROR}, "
+                   "ID: {ID}, FILENAME: {FILENAME}",
+                   "ERROR", e, "ID", id, "FILENAME", file);
+        return;
+    }
+    digestSource = std::make_unique<sdeventplus::source::Defer>(
+        sdeventplus::Event::get_default(),
+        [this](auto& /*source*/) { digestCallback(); });
+    digestSource->set_priority(SD_EVENT_PRIORITY_IDLE);
+    digestSource->set_enabled(sdeventplus::source::Enabled::On);
+}
+
+void Entry::digestCallback()
+{
+    auto& buffer = digestState->buffer;
+    auto readChunk = [&buffer](int fd, off_t* offset, size_t count) {
+        auto numOfBytes = pread(fd, buffer.data(), count, *offset);
+        if (numOfBytes > 0)
+        {
+            *offset += numOfBytes;
+        }
+        return numOfBytes;
+    };
+
+    try
+    {
+        auto numOfBytes = digestState->reader.transfer(buffer.size(),
+                                                        readChunk);
+        if (numOfBytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                return;
+            }
+            throw std::system_error(errno, std::generic_category(),
+                                    "Failed to read the dump");
+        }
+        if (numOfBytes > 0)
+        {
+            digestState->hasher.update(buffer.data(), numOfBytes);
+            return;
+        }
+
+        digest(digestState->hasher.final());
+        algorithm(HashAlgorithm::SHA256);
+        serialize(file.parent_path() / ".preserve" / "serialized_entry.bin");
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to compute the dump digest, errormsg: {ERROR}, "
+                   "ID: {ID}, FILENAME: {FILENAME}",
+                   "ERROR", e, "ID", id, "FILENAME", file);
+    }
+    stopDigest();
+}
+
+void Entry::stopDigest()
+{
+    digestSource.reset();
+    digestState.reset();
+}
+
+void Entry::serializeExtra(cereal::BinaryOutputArchive& archive)
+{
+    archive(digest(), dumpType, offloaded());
+}
+
+void Entry::deserializeExtra(cereal::BinaryInputArchive& archive)
+{
+    std::string digestValue;
+    bool offloadedValue = false;
+    try
+    {
+        archive(digestValue);
+        archive(dumpType, offloadedValue);
+    }
+    catch (const cereal::Exception&)
+    {
+        // Entries serialized by older versions have no digest, type and
+        // offload state
+    }
+    digest(digestValue);
+    offloaded(offloadedValue);
+}
+
+void Entry::deserialize(const std::filesystem::path& filePath)
+{
+    phosphor::dump::Entry::deserialize(filePath);
+    if (digest().empty())
+    {
+        updateDigest();
+        serialize(filePath);
+    }
+}
+
 void Entry::initiateOffload(std::string uri)
 {
-    phosphor::dump::offload::requestOffload(file, id, uri);
-    offloaded(true);
+    startOffload(uri, 0);
+}
+
+void Entry::resumeOffload(std::string uri, uint64_t offset)
+{
+    lg2::info("Resuming offload, ID: {ID}, OFFSET: {OFFSET}", "ID", id,
+              "OFFSET", offset);
+    startOffload(uri, offset);
+}
+
+void Entry::startOffload(const std::string& uri, uint64_t offset)
+{
+    if (offloadSession && offloadSession->isActive())
+    {
+        lg2::error("Offload already in progress, ID: {ID}", "ID", id);
+        elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
+    }
+
+    offloadSession = std::make_unique<phosphor::dump::offload::Session>(
+        sdeventplus::Event::get_default(), file, id, uri, offset,
+        offloadScheduler, std::bind_front(&Entry::offloadStatus, this));
+}
+
+sdbusplus::message::unix_fd Entry::getFileHandle()
+{
+    // A deduplicated dump has no file a seekable descriptor could refer to
+    if (!file.empty() && phosphor::dump::store::deduplicated(file))
+    {
+        lg2::error("Failed to get the file handle of deduplicated dump, "
+                   "ID: {ID}",
+                   "ID", id);
+        using NotAllowed =
+            sdbusplus::xyz::openbmc_project::Common::Error::NotAllowed;
+        using Reason = xyz::openbmc_project::Common::NotAllowed::REASON;
+        elog<NotAllowed>(Reason("The dump is deduplicated, use "
+                                "InitiateOffload or GetFileRange"));
+    }
+    return phosphor::dump::Entry::getFileHandle();
+}
+
+sdbusplus::message::unix_fd Entry::getFileRange(uint64_t offset,
+                                                uint64_t length)
+{
+    if (file.empty())
+    {
+        lg2::error("Failed to get file range: File path is empty.");
+        elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
+    }
+
+    auto streaming = std::ranges::count_if(
+        rangeStreams, [](const auto& stream) { return stream->isActive(); });
+    if (streaming >= BMC_DUMP_MAX_RANGES)
+    {
+        lg2::error("Too many ranges of the dump being streamed, ID: {ID}, "
+                   "RANGES: {RANGES}",
+                   "ID", id, "RANGES", streaming);
+        elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
+    }
+
+    auto stream = std::make_unique<phosphor::dump::offload::RangeStream>(
+        sdeventplus::Event::get_default(), file, id, offset, length,
+        [this](auto&) { releaseRangeStreams(); });
+    int fd = stream->releaseReadFD();
+    if (stream->isActive())
+    {
+        rangeStreams.push_back(std::move(stream));
+    }
+
+    deferCloseFD(fd);
+    return fd;
+}
+
+void Entry::releaseRangeStreams()
+{
+    if (!rangeReleaseSource)
+    {
+        rangeReleaseSource = std::make_unique<sdeventplus::source::Defer>(
+            sdeventplus::Event::get_default(), [this](auto&) {
+                std::erase_if(rangeStreams, [](const auto& stream) {
+                    return !stream->isActive();
+                });
+                rangeReleaseSource.reset();
+            });
+    }
+}
+
+void Entry::offloadStatus(
+    phosphor::dump::offload::Session::State state,
+    const phosphor::dump::offload::Session::Progress& progress)
+{
+    using State = phosphor::dump::offload::Session::State;
+
+    switch (state)
+    {
+        case State::Queued:
+            offloadState(OffloadState::Queued);
+            break;
+        case State::InProgress:
+            offloadState(OffloadState::InProgress);
+            break;
+        case State::Completed:
+            offloadState(OffloadState::Completed);
+            offloaded(true);
+            serialize(file.parent_path() / ".preserve" /
+                      "serialized_entry.bin");
+            parent.entryUpdated(id);
+            break;
+        case State::Failed:
+            offloadState(OffloadState::Failed);
+            break;
+    }
+    bytesSent(progress.bytesSent);
+    transferRate(progress.rate);
+    acknowledgedOffset(progress.acknowledged);
 }
 
 } // namespace bmc
@@ -1,7 +1,13 @@
 #pragma once
 
+#include "dump_digest.hpp"
 #include "dump_entry.hpp"
+#include "dump_offload.hpp"
+#include "dump_store.hpp"
 #include "xyz/openbmc_project/Dump/Entry/BMC/server.hpp"
+#include "xyz/openbmc_project/Dump/Entry/FileRange/server.hpp"
+#include "xyz/openbmc_project/Dump/Entry/Integrity/server.hpp"
+#include "xyz/openbmc_project/Dump/Entry/OffloadProgress/server.hpp"
 #include "xyz/openbmc_project/Dump/Entry/server.hpp"
 #include "xyz/openbmc_project/Object/Delete/server.hpp"
 #include "xyz/openbmc_project/Time/EpochTime/server.hpp"
@@ -10,6 +16,10 @@
 #include <sdbusplus/server/object.hpp>
 
 #include <filesystem>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace phosphor
 {
@@ -21,7 +31,16 @@ template <typename T>
 using ServerObject = typename sdbusplus::server::object_t<T>;
 
 using EntryIfaces = sdbusplus::server::object_t<
-    sdbusplus::xyz::openbmc_project::Dump::Entry::server::BMC>;
+    sdbusplus::xyz::openbmc_project::Dump::Entry::server::BMC,
+    sdbusplus::xyz::openbmc_project::Dump::Entry::server::FileRange,
+    sdbusplus::xyz::openbmc_project::Dump::Entry::server::Integrity,
+    sdbusplus::xyz::openbmc_project::Dump::Entry::server::OffloadProgress>;
+
+using OffloadState = sdbusplus::xyz::openbmc_project::Dump::Entry::server::
+    OffloadProgress::State;
+
+using HashAlgorithm = sdbusplus::xyz::openbmc_project::Dump::Entry::server::
+    Integrity::HashAlgorithm;
 
 using originatorTypes = sdbusplus::xyz::openbmc_project::Common::server::
     OriginatedBy::OriginatorTypes;
@@ -55,16 +74,19 @@ class Entry : virtual public phosphor::dump::Entry, virtual public EntryIfaces
      *  @param[in] originatorId - Id of the originator of the dump
      *  @param[in] originatorType - Originator type
      *  @param[in] parent - The dump entry's parent.
+     *  @param[in] offloadScheduler - Scheduler for the offload of the dump.
      */
     Entry(sdbusplus::bus_t& bus, const std::string& objPath, uint32_t dumpId,
           uint64_t timeStamp, uint64_t fileSize,
           const std::filesystem::path& file,
           phosphor::dump::OperationStatus status, std::string originatorId,
-          originatorTypes originatorType, phosphor::dump::Manager& parent) :
+          originatorTypes originatorType, phosphor::dump::Manager& parent,
+          phosphor::dump::offload::Scheduler& offloadScheduler) :
         phosphor::dump::Entry(bus, objPath.c_str(), dumpId, timeStamp, fileSize,
                               file, status, originatorId, originatorType,
                               parent),
-        EntryIfaces(bus, objPath.c_str(), EntryIfaces::action::defer_emit)
+        EntryIfaces(bus, objPath.c_str(), EntryIfaces::action::defer_emit),
+        offloadScheduler(offloadScheduler)
     {
         // Emit deferred signal.
         this->phosphor::dump::bmc::EntryIfaces::emit_object_added();
@@ -75,10 +97,48 @@ class Entry : virtual public phosphor::dump::Entry, virtual public EntryIfaces
     void delete_() override;
 
     /** @brief Method to initiate the offload of dump
+     *  @details The offload is queued on the offload scheduler and runs on
+     *  the event loop, this returns as soon as the socket is ready for the
+     *  consumer to connect. The OffloadProgress properties follow the
+     *  session and the offloaded property is set once the whole dump has
+     *  been sent.
      *  @param[in] uri - URI to offload dump
      */
     void initiateOffload(std::string uri) override;
 
+    /** @brief Method to continue an interrupted offload of dump
+     *  @details Same as initiateOffload, except that only the part of the
+     *  dump starting at offset is sent.
+     *  @param[in] uri - URI to offload dump
+     *  @param[in] offset - Offset of the first byte of the dump to send
+     */
+    void resumeOffload(std::string uri, uint64_t offset) override;
+
+    /** @brief Method to get the file handle of the dump
+     *  @details A deduplicated dump has no file to return a seekable handle
+     *  to, NotAllowed is raised: it is read with initiateOffload or
+     *  getFileRange.
+     *  @returns A Unix file descriptor to the dump
+     */
+    sdbusplus::message::unix_fd getFileHandle() override;
+
+    /** @brief Method to get a handle to a range of the dump
+     *  @details At most BMC_DUMP_MAX_RANGES ranges of the dump are streamed
+     *  at the same time, a stream is released as soon as it finishes.
+     *  @param[in] offset - Offset of the first byte of the range
+     *  @param[in] length - Number of bytes in the range, 0 for up to the end
+     *  of the dump
+     *  @returns The read end of a pipe the range is written to
+     *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Open on
+     *  failure to open the file
+     *  @throws sdbusplus::xyz::openbmc_project::Common::Error::Unavailable if
+     *  the file string is empty or too many ranges are being streamed
+     *  @throws sdbusplus::xyz::openbmc_project::Common::Error::InvalidArgument
+     *  if the offset is beyond the end of the dump
+     */
+    sdbusplus::message::unix_fd getFileRange(uint64_t offset,
+                                             uint64_t length) override;
+
     /** @brief Method to update an existing dump entry, once the dump creation
      *  is completed this function will be used to update the entry which got
      *  created during the dump request.
@@ -97,10 +157,121 @@ class Entry : virtual public phosphor::dump::Entry, virtual public EntryIfaces
         // TODO: serialization of this property will be handled with
         // #ibm-openbmc/2597
         completedTime(timeStamp);
+        updateDigest();
         const std::filesystem::path serializedFilePath =
             filePath.parent_path() / ".preserve" / "serialized_entry.bin";
         serialize(serializedFilePath);
     }
+
+    /** @brief Update the Integrity properties with the digest of the dump
+     *  @details dreport hashes the archive while writing it and leaves the
+     *  digest next to it, the digest is taken from there. Without one, the
+     *  archive is hashed a chunk at a time from an idle event source and
+     *  the entry is serialized again once the digest is known. The digest
+     *  is persisted with the entry, offloads publish it without reading the
+     *  dump again.
+     */
+    void updateDigest();
+
+    /**
+     * @brief Deserialize the dump entry attributes and the digest from a
+     * file. The digest is computed if the file was written without one.
+     *
+     * @param[in] filePath - The path to the file from where the entry
+     *                       will be deserialized.
+     */
+    void deserialize(const std::filesystem::path& filePath) override;
+
+    /** @brief Returns the dump type
+     *  @return the name of the dump type, empty if unknown
+     */
+    const std::string& getDumpType() const
+    {
+        return dumpType;
+    }
+
+    /** @brief Set the dump type, persisted with the entry
+     *  @param[in] type - name of the dump type
+     */
+    void setDumpType(const std::string& type)
+    {
+        dumpType = type;
+    }
+
+  protected:
+    /** @brief Serialize the digest, the dump type and the offload state */
+    void serializeExtra(cereal::BinaryOutputArchive& archive) override;
+
+    /** @brief Deserialize the digest, the dump type and the offload state */
+    void deserializeExtra(cereal::BinaryInputArchive& archive) override;
+
+  private:
+    /** @brief Hash the next chunk of the dump, from the idle event source */
+    void digestCallback();
+
+    /** @brief Stop hashing the dump in the background */
+    void stopDigest();
+
+    /** @struct DigestState
+     *  @brief Dump being hashed in the background
+     */
+    struct DigestState
+    {
+        /** @brief Open the dump
+         *  @param[in] file - Path of the dump.
+         */
+        explicit DigestState(const std::filesystem::path& file);
+
+        /** @brief Reader of the dump */
+        phosphor::dump::store::Reader reader;
+
+        /** @brief Digest of the bytes read so far */
+        phosphor::dump::digest::Hasher hasher;
+
+        /** @brief Chunk read from the dump */
+        std::vector<char> buffer;
+    };
+
+    /** @brief Queue an offload session for the dump
+     *  @param[in] uri - URI to offload dump
+     *  @param[in] offset - Offset of the first byte of the dump to send
+     */
+    void startOffload(const std::string& uri, uint64_t offset);
+
+    /** @brief Update the offload progress properties
+     *  @param[in] state - state of the offload session
+     *  @param[in] progress - progress of the offload session
+     */
+    void offloadStatus(
+        phosphor::dump::offload::Session::State state,
+        const phosphor::dump::offload::Session::Progress& progress);
+
+    /** @brief Scheduler for the offload of the dump */
+    phosphor::dump::offload::Scheduler& offloadScheduler;
+
+    /** @brief Release the finished range streams */
+    void releaseRangeStreams();
+
+    /** @brief Offload in progress or last completed offload */
+    std::unique_ptr<phosphor::dump::offload::Session> offloadSession;
+
+    /** @brief Ranges of the dump being streamed */
+    std::list<std::unique_ptr<phosphor::dump::offload::RangeStream>>
+        rangeStreams;
+
+    /** @brief Event source releasing the finished range streams, a stream
+     *  can not be destroyed from its own done callback */
+    std::unique_ptr<sdeventplus::source::Defer> rangeReleaseSource;
+
+    /** @brief Name of the dump type, empty for the dumps created before the
+     *  type was persisted */
+    std::string dumpType;
+
+    /** @brief Dump being hashed in the background */
+    std::unique_ptr<DigestState> digestState;
+
+    /** @brief Idle event source hashing the dump */
+    std::unique_ptr<sdeventplus::source::Defer> digestSource;
 };
 
 } // namespace bmc
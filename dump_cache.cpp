@@ -0,0 +1,91 @@
+#include "dump_cache.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <fstream>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace cache
+{
+
+constexpr auto softwarePath = "/xyz/openbmc_project/software";
+constexpr auto progressInterface =
+    "xyz.openbmc_project.Software.ActivationProgress";
+constexpr auto hostnamePath = "/org/freedesktop/hostname1";
+constexpr auto hostnameInterface = "org.freedesktop.hostname1";
+
+/** @brief Outputs depending on the software images */
+static const std::vector<std::string> softwareOutputs = {
+    "redundant-os-release", "min-fw-level", "fw-printenv.log",
+    "alt-fw-printenv.log"};
+
+/** @brief Outputs depending on the hostname settings */
+static const std::vector<std::string> hostnameOutputs = {"hostnamectl.log"};
+
+Invalidator::Invalidator(sdbusplus::bus_t& bus,
+                         const std::filesystem::path& dir) : dir(dir)
+{
+    using namespace sdbusplus::bus::match::rules;
+
+    // Activation, priority and version changes, not the progress of an
+    // activation which only updates the percentage.
+    matches.emplace_back(
+        bus,
+        type::signal() + member("PropertiesChanged") +
+            interface("org.freedesktop.DBus.Properties") +
+            path_namespace(softwarePath),
+        [this](sdbusplus::message_t& msg) {
+            std::string changedInterface;
+            try
+            {
+                msg.read(changedInterface);
+            }
+            catch (const sdbusplus::exception_t& e)
+            {
+                return;
+            }
+            if (changedInterface != progressInterface)
+            {
+                invalidate(softwareOutputs);
+            }
+        });
+    matches.emplace_back(
+        bus, interfacesAdded() + path_namespace(softwarePath),
+        [this](sdbusplus::message_t&) { invalidate(softwareOutputs); });
+    matches.emplace_back(
+        bus, interfacesRemoved() + path_namespace(softwarePath),
+        [this](sdbusplus::message_t&) { invalidate(softwareOutputs); });
+    matches.emplace_back(
+        bus, propertiesChanged(hostnamePath, hostnameInterface),
+        [this](sdbusplus::message_t&) { invalidate(hostnameOutputs); });
+
+    // The changes made while the manager was not running were missed
+    invalidate(softwareOutputs);
+    invalidate(hostnameOutputs);
+}
+
+void Invalidator::invalidate(const std::vector<std::string>& outputs) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    for (const auto& output : outputs)
+    {
+        auto file = dir / (output + ".invalidated");
+        std::ofstream(file).close();
+        std::filesystem::last_write_time(
+            file, std::filesystem::file_time_type::clock::now(), ec);
+        if (ec)
+        {
+            lg2::error("Failed to invalidate the cached {OUTPUT}, "
+                       "error: {ERROR}",
+                       "OUTPUT", output, "ERROR", ec.message());
+        }
+    }
+}
+
+} // namespace cache
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace cache
+{
+
+/** @class Invalidator
+ *  @brief Invalidates the dreport outputs of the collection cache which
+ *  depend on D-Bus state.
+ *  @details dreport keeps the output of the plugins of static data in the
+ *  cache directory and links it into the next dumps as long as its sources
+ *  did not change. The sources of an output include the
+ *  <output>.invalidated file of the cache, which is updated here when the
+ *  software images or the hostname settings change.
+ */
+class Invalidator
+{
+  public:
+    Invalidator() = delete;
+    Invalidator(const Invalidator&) = delete;
+    Invalidator& operator=(const Invalidator&) = delete;
+    Invalidator(Invalidator&&) = delete;
+    Invalidator& operator=(Invalidator&&) = delete;
+    ~Invalidator() = default;
+
+    /** @brief Constructor to watch the D-Bus changes.
+     *  @param[in] bus - Bus to attach to.
+     *  @param[in] dir - Collection cache directory of dreport.
+     */
+    Invalidator(sdbusplus::bus_t& bus, const std::filesystem::path& dir);
+
+  private:
+    /** @brief Invalidate cached outputs
+     *  @param[in] outputs - Names of the outputs in the cache.
+     */
+    void invalidate(const std::vector<std::string>& outputs) const;
+
+    /** @brief Collection cache directory */
+    std::filesystem::path dir;
+
+    /** @brief Matches of the signals invalidating outputs */
+    std::vector<sdbusplus::bus::match_t> matches;
+};
+
+} // namespace cache
+} // namespace dump
+} // namespace phosphor
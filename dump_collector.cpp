@@ -0,0 +1,821 @@
+#include "config.h"
+
+#include "dump_collector.hpp"
+
+#include "dump_journal.hpp"
+
+#include <sys/sysinfo.h>
+#include <sys/utsname.h>
+#include <systemd/sd-bus.h>
+
+#include <nlohmann/json.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace collector
+{
+
+/** @struct Context
+ *  @brief Parameters of the dump being collected
+ */
+struct Context
+{
+    sdbusplus::bus_t& bus;
+
+    /** @brief Path of the dump, then the paths of the error logs coalesced
+     *  into the dump */
+    const std::vector<std::string>& paths;
+    const std::filesystem::path& dir;
+};
+
+/** @struct Call
+ *  @brief D-Bus method call of which the reply is the output of a plugin
+ */
+struct Call
+{
+    std::string service;
+    std::string object;
+    std::string intf;
+    std::string method;
+    std::vector<std::string> args;
+
+    /** @brief File the reply is written to, as JSON */
+    std::string fileName;
+};
+
+/** @struct Plugin
+ *  @brief Native implementation of a dreport plugin
+ */
+struct Plugin
+{
+    /** @brief Name of the dreport plugin */
+    std::string name;
+
+    /** @brief Dump types the plugin is configured for */
+    std::vector<std::string> types;
+
+    /** @brief Collect the data, returns false on failure. Called after the
+     *  snapshot call, if any, succeeded. */
+    std::function<bool(const Context&)> collect;
+
+    /** @brief D-Bus calls of the plugin, issued concurrently with the calls
+     *  of the other plugins, none if they can not be made */
+    std::function<std::vector<Call>(const Context&)> snapshot = nullptr;
+};
+
+/** @brief Timeout of the snapshot calls, the default of busctl */
+constexpr auto snapshotTimeout = std::chrono::seconds(25);
+
+struct FileCloser
+{
+    void operator()(FILE* file) const
+    {
+        fclose(file);
+    }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+/** @brief Copy a file, reading it as a stream so that files of pseudo file
+ *  systems which report a size of 0 are copied too.
+ *  @param[in] source - file to copy
+ *  @param[in] target - file to create
+ *  @return true on success
+ */
+static bool copyFile(const std::filesystem::path& source,
+                     const std::filesystem::path& target)
+{
+    std::ifstream in(source, std::ios::binary);
+    std::ofstream out(target, std::ios::binary);
+    if (!in.is_open() || !out.is_open())
+    {
+        return false;
+    }
+    out << in.rdbuf();
+    return !out.fail();
+}
+
+/** @brief Read a string property
+ *  @throws sdbusplus::exception_t if the property can not be read.
+ */
+static std::string getProperty(sdbusplus::bus_t& bus,
+                               const std::string& service,
+                               const std::string& object,
+                               const std::string& intf,
+                               const std::string& prop)
+{
+    auto method = bus.new_method_call(service.c_str(), object.c_str(),
+                                      "org.freedesktop.DBus.Properties", "Get");
+    method.append(intf, prop);
+    std::variant<std::string> value;
+    bus.call(method).read(value);
+    return std::get<std::string>(value);
+}
+
+/** @brief Write the value of a string property in the format of
+ *  "busctl get-property".
+ *  @return true on success
+ */
+static bool writeProperty(const Context& ctx, const std::string& service,
+                          const std::string& object, const std::string& intf,
+                          const std::string& prop, const std::string& fileName)
+{
+    try
+    {
+        auto value = getProperty(ctx.bus, service, object, intf, prop);
+        std::ofstream out(ctx.dir / fileName);
+        out << "s \"" << value << "\"" << std::endl;
+        return !out.fail();
+    }
+    catch (const std::exception& e)
+    {
+        return false;
+    }
+}
+
+struct SlotUnref
+{
+    void operator()(sd_bus_slot* slot) const
+    {
+        sd_bus_slot_unref(slot);
+    }
+};
+using SlotPtr = std::unique_ptr<sd_bus_slot, SlotUnref>;
+
+/** @brief Throw a std::runtime_error if an sd-bus call failed */
+static void check(int r, const char* what)
+{
+    if (r < 0)
+    {
+        throw std::runtime_error(std::string("Failed to ") + what +
+                                 ", error: " + std::strerror(-r));
+    }
+}
+
+/** @brief Read the next complete value of a message as JSON.
+ *  @details Arrays of dict entries are read as objects, structures and
+ *  other arrays as arrays, variants as their value.
+ */
+static nlohmann::json readValue(sd_bus_message* m)
+{
+    char type = 0;
+    const char* contents = nullptr;
+    check(sd_bus_message_peek_type(m, &type, &contents), "peek the type");
+
+    switch (type)
+    {
+        case SD_BUS_TYPE_ARRAY:
+        {
+            bool dict = (contents[0] == SD_BUS_TYPE_DICT_ENTRY_BEGIN);
+            auto value = dict ? nlohmann::json::object()
+                              : nlohmann::json::array();
+            check(sd_bus_message_enter_container(m, type, contents),
+                  "enter an array");
+            while (sd_bus_message_at_end(m, 0) == 0)
+            {
+                if (!dict)
+                {
+                    value.push_back(readValue(m));
+                    continue;
+                }
+                check(sd_bus_message_enter_container(
+                          m, SD_BUS_TYPE_DICT_ENTRY, nullptr),
+                      "enter a dict entry");
+                auto key = readValue(m);
+                value[key.is_string() ? key.get<std::string>()
+                                      : key.dump()] = readValue(m);
+                check(sd_bus_message_exit_container(m), "exit a dict entry");
+            }
+            check(sd_bus_message_exit_container(m), "exit an array");
+            return value;
+        }
+        case SD_BUS_TYPE_VARIANT:
+        {
+            check(sd_bus_message_enter_container(m, type, contents),
+                  "enter a variant");
+            auto value = readValue(m);
+            check(sd_bus_message_exit_container(m), "exit a variant");
+            return value;
+        }
+        case SD_BUS_TYPE_STRUCT:
+        {
+            auto value = nlohmann::json::array();
+            check(sd_bus_message_enter_container(m, type, contents),
+                  "enter a structure");
+            while (sd_bus_message_at_end(m, 0) == 0)
+            {
+                value.push_back(readValue(m));
+            }
+            check(sd_bus_message_exit_container(m), "exit a structure");
+            return value;
+        }
+        default:
+            break;
+    }
+
+    union
+    {
+        uint8_t y;
+        int b;
+        int16_t n;
+        uint16_t q;
+        int32_t i;
+        uint32_t u;
+        int64_t x;
+        uint64_t t;
+        double d;
+        const char* s;
+    } basic;
+    check(sd_bus_message_read_basic(m, type, &basic), "read a value");
+    switch (type)
+    {
+        case SD_BUS_TYPE_BYTE:
+            return basic.y;
+        case SD_BUS_TYPE_BOOLEAN:
+            return basic.b != 0;
+        case SD_BUS_TYPE_INT16:
+            return basic.n;
+        case SD_BUS_TYPE_UINT16:
+            return basic.q;
+        case SD_BUS_TYPE_INT32:
+        case SD_BUS_TYPE_UNIX_FD:
+            return basic.i;
+        case SD_BUS_TYPE_UINT32:
+            return basic.u;
+        case SD_BUS_TYPE_INT64:
+            return basic.x;
+        case SD_BUS_TYPE_UINT64:
+            return basic.t;
+        case SD_BUS_TYPE_DOUBLE:
+            return basic.d;
+        default:
+            return basic.s;
+    }
+}
+
+/** @struct Snapshot
+ *  @brief Pending snapshot call of a plugin
+ */
+struct Snapshot
+{
+    std::filesystem::path file;
+    SlotPtr slot;
+    bool done = false;
+    bool collected = false;
+};
+
+/** @brief Write the reply of a snapshot call as JSON */
+static int snapshotReply(sd_bus_message* reply, void* userdata,
+                         sd_bus_error* /*error*/)
+{
+    auto snapshot = static_cast<Snapshot*>(userdata);
+    snapshot->done = true;
+
+    if (sd_bus_message_is_method_error(reply, nullptr))
+    {
+        lg2::error("Snapshot call for {PATH} failed, error: {ERROR}", "PATH",
+                   snapshot->file, "ERROR",
+                   sd_bus_message_get_error(reply)->name);
+        return 0;
+    }
+
+    try
+    {
+        auto value = nlohmann::json::array();
+        while (sd_bus_message_at_end(reply, 1) == 0)
+        {
+            value.push_back(readValue(reply));
+        }
+        if (value.size() == 1)
+        {
+            value = value[0];
+        }
+
+        std::ofstream out(snapshot->file);
+        out << value.dump(-1, ' ', false,
+                          nlohmann::json::error_handler_t::replace);
+        out.close();
+        snapshot->collected = !out.fail();
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to write the snapshot {PATH}, error: {ERROR}",
+                   "PATH", snapshot->file, "ERROR", e);
+    }
+    return 0;
+}
+
+/** @brief Issue the snapshot calls of the plugins concurrently and write
+ *  the replies as they arrive.
+ *  @details The replies are waited for in the collector process, which has
+ *  nothing else to serve: the dump manager only waits for the exit of the
+ *  process.
+ *  @return Plugin names and files of the snapshots written, for the
+ *  plugins of which all the snapshots were written.
+ */
+static std::map<std::string, std::vector<std::filesystem::path>>
+    takeSnapshots(const Context& ctx, const std::vector<const Plugin*>& list)
+{
+    std::map<std::string, std::vector<std::filesystem::path>> files;
+    std::map<std::string, std::vector<Snapshot>> snapshots;
+    try
+    {
+        auto& bus = ctx.bus;
+        auto timeout =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                snapshotTimeout)
+                .count();
+
+        for (const auto* plugin : list)
+        {
+            auto calls = plugin->snapshot(ctx);
+            if (calls.empty())
+            {
+                continue;
+            }
+
+            // The replies are written through the snapshots, which do not
+            // move once the calls are issued
+            auto& pluginSnapshots = snapshots[plugin->name];
+            pluginSnapshots.resize(calls.size());
+            for (size_t i = 0; i < calls.size(); i++)
+            {
+                const auto& call = calls[i];
+                auto method = bus.new_method_call(
+                    call.service.c_str(), call.object.c_str(),
+                    call.intf.c_str(), call.method.c_str());
+                for (const auto& arg : call.args)
+                {
+                    method.append(arg);
+                }
+
+                auto& snapshot = pluginSnapshots[i];
+                snapshot.file = ctx.dir / call.fileName;
+                sd_bus_slot* slot = nullptr;
+                auto r = sd_bus_call_async(bus.get(), &slot, method.get(),
+                                           snapshotReply, &snapshot, timeout);
+                if (r < 0)
+                {
+                    lg2::error("Failed to call {METHOD} on {OBJECT_PATH}, "
+                               "error: {ERROR}",
+                               "METHOD", call.method, "OBJECT_PATH",
+                               call.object, "ERROR", std::strerror(-r));
+                    snapshot.done = true;
+                    continue;
+                }
+                snapshot.slot.reset(slot);
+            }
+        }
+
+        // The calls time out on their own, the deadline only guards the
+        // loop against a connection which stops delivering.
+        auto deadline = std::chrono::steady_clock::now() + snapshotTimeout +
+                        std::chrono::seconds(1);
+        auto pending = [&snapshots]() {
+            return std::ranges::any_of(snapshots, [](const auto& plugin) {
+                return std::ranges::any_of(plugin.second,
+                                           [](const auto& snapshot) {
+                    return !snapshot.done;
+                });
+            });
+        };
+        while (pending() && (std::chrono::steady_clock::now() < deadline))
+        {
+            auto r = sd_bus_process(bus.get(), nullptr);
+            if (r > 0)
+            {
+                continue;
+            }
+            check(r, "process the snapshot replies");
+            check(sd_bus_wait(bus.get(), timeout), "wait for the replies");
+        }
+
+        // Release the calls still pending before the connection is closed
+        for (auto& [name, pluginSnapshots] : snapshots)
+        {
+            for (auto& snapshot : pluginSnapshots)
+            {
+                snapshot.slot.reset();
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to take the D-Bus snapshots, error: {ERROR}",
+                   "ERROR", e);
+    }
+
+    for (auto& [name, pluginSnapshots] : snapshots)
+    {
+        std::vector<std::filesystem::path> written;
+        for (const auto& snapshot : pluginSnapshots)
+        {
+            written.push_back(snapshot.file);
+        }
+        if (std::ranges::all_of(pluginSnapshots, [](const auto& snapshot) {
+                return snapshot.collected;
+            }))
+        {
+            files.emplace(name, std::move(written));
+            continue;
+        }
+
+        // A plugin missing a snapshot is left to the dreport plugin
+        for (const auto& file : written)
+        {
+            std::error_code ec;
+            std::filesystem::remove(file, ec);
+        }
+    }
+    return files;
+}
+
+/** @brief GetManagedObjects call of an object manager */
+static Call managedObjects(const std::string& service,
+                           const std::string& object,
+                           const std::string& fileName)
+{
+    return {service, object, "org.freedesktop.DBus.ObjectManager",
+            "GetManagedObjects", {}, fileName};
+}
+
+/** @brief Write the system uptime and load in the format of "uptime" */
+static bool collectUptime(const Context& ctx)
+{
+    struct sysinfo info;
+    if (sysinfo(&info) < 0)
+    {
+        return false;
+    }
+    auto now = std::time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    auto upMinutes = info.uptime / 60;
+    auto upHours = (upMinutes / 60) % 24;
+    auto upDays = info.uptime / (60 * 60 * 24);
+    upMinutes %= 60;
+
+    // Loads are fixed point values with SI_LOAD_SHIFT fraction bits
+    auto loadInt = [](unsigned long load) { return load >> SI_LOAD_SHIFT; };
+    auto loadFrac = [](unsigned long load) {
+        return ((load & ((1UL << SI_LOAD_SHIFT) - 1)) * 100) >> SI_LOAD_SHIFT;
+    };
+
+    FilePtr file(fopen((ctx.dir / "uptime.log").c_str(), "we"));
+    if (!file)
+    {
+        return false;
+    }
+    fprintf(file.get(), " %02d:%02d:%02d up ", local.tm_hour, local.tm_min,
+            local.tm_sec);
+    if (upDays)
+    {
+        fprintf(file.get(), "%ld day%s, ", upDays, (upDays != 1) ? "s" : "");
+    }
+    if (upHours)
+    {
+        fprintf(file.get(), "%2ld:%02ld", upHours, upMinutes);
+    }
+    else
+    {
+        fprintf(file.get(), "%ld min", upMinutes);
+    }
+    fprintf(file.get(), ",  load average: %lu.%02lu, %lu.%02lu, %lu.%02lu\n",
+            loadInt(info.loads[0]), loadFrac(info.loads[0]),
+            loadInt(info.loads[1]), loadFrac(info.loads[1]),
+            loadInt(info.loads[2]), loadFrac(info.loads[2]));
+    return true;
+}
+
+/** @brief Write the hostname settings in the format of "hostnamectl" */
+static bool collectHostname(const Context& ctx)
+{
+    constexpr auto service = "org.freedesktop.hostname1";
+    constexpr auto object = "/org/freedesktop/hostname1";
+
+    auto property = [&ctx](const std::string& prop) -> std::string {
+        try
+        {
+            return getProperty(ctx.bus, service, object, service, prop);
+        }
+        catch (const std::exception& e)
+        {
+            return {};
+        }
+    };
+    auto firstLine = [](const std::filesystem::path& file) {
+        std::string line;
+        std::ifstream in(file);
+        std::getline(in, line);
+        return line;
+    };
+
+    auto staticHostname = property("StaticHostname");
+    auto hostname = property("Hostname");
+    if (staticHostname.empty() && hostname.empty())
+    {
+        return false;
+    }
+
+    struct utsname uts;
+    if (uname(&uts) < 0)
+    {
+        return false;
+    }
+
+    std::ofstream out(ctx.dir / "hostnamectl.log");
+    auto line = [&out](const std::string& label, const std::string& value) {
+        if (!value.empty())
+        {
+            out << std::setw(16) << label << ": " << value << "\n";
+        }
+    };
+    line("Static hostname", staticHostname.empty() ? "n/a" : staticHostname);
+    if (hostname != staticHostname)
+    {
+        line("Transient hostname", hostname);
+    }
+    line("Icon name", property("IconName"));
+    line("Chassis", property("Chassis"));
+    line("Deployment", property("Deployment"));
+    line("Location", property("Location"));
+    line("Machine ID", firstLine("/etc/machine-id"));
+    auto bootId = firstLine("/proc/sys/kernel/random/boot_id");
+    std::erase(bootId, '-');
+    line("Boot ID", bootId);
+    line("Operating System", property("OperatingSystemPrettyName"));
+    line("Kernel", std::string(uts.sysname) + " " + uts.release);
+    line("Architecture", uts.machine);
+    return !out.fail();
+}
+
+/** @brief Copy the OS release information */
+static bool collectOsRelease(const Context& ctx)
+{
+    return copyFile("/etc/os-release", ctx.dir / "os-release");
+}
+
+/** @brief Copy the memory information */
+static bool collectMeminfo(const Context& ctx)
+{
+    return copyFile("/proc/meminfo", ctx.dir / "meminfo");
+}
+
+/** @brief Copy the CPU information */
+static bool collectCpuinfo(const Context& ctx)
+{
+    return copyFile("/proc/cpuinfo", ctx.dir / "cpuinfo");
+}
+
+/** @brief Write the current BMC state */
+static bool collectBmcState(const Context& ctx)
+{
+    return writeProperty(ctx, "xyz.openbmc_project.State.BMC",
+                         "/xyz/openbmc_project/state/bmc0",
+                         "xyz.openbmc_project.State.BMC", "CurrentBMCState",
+                         "bmc-state.log");
+}
+
+/** @brief Write the current host state */
+static bool collectHostState(const Context& ctx)
+{
+    return writeProperty(ctx, "xyz.openbmc_project.State.Host",
+                         "/xyz/openbmc_project/state/host0",
+                         "xyz.openbmc_project.State.Host", "CurrentHostState",
+                         "host-state.log");
+}
+
+/** @brief Write the current chassis power state */
+static bool collectChassisState(const Context& ctx)
+{
+    return writeProperty(ctx, "xyz.openbmc_project.State.Chassis",
+                         "/xyz/openbmc_project/state/chassis0",
+                         "xyz.openbmc_project.State.Chassis",
+                         "CurrentPowerState", "chassis-state.log");
+}
+
+/** @brief Snapshot of the inventory objects */
+static std::vector<Call> snapshotInventory(const Context&)
+{
+    return {managedObjects("xyz.openbmc_project.Inventory.Manager",
+                           "/xyz/openbmc_project/inventory",
+                           "inventory.json")};
+}
+
+/** @brief Snapshot of all the error logs */
+static std::vector<Call> snapshotElogAll(const Context&)
+{
+    return {managedObjects("xyz.openbmc_project.Logging",
+                           "/xyz/openbmc_project/logging", "elogall.json")};
+}
+
+/** @brief Snapshot of the properties of the error logs the dump is
+ *  collected for
+ */
+static std::vector<Call> snapshotElog(const Context& ctx)
+{
+    std::vector<Call> calls;
+    if (ctx.paths.empty() || ctx.paths.front().empty())
+    {
+        return calls;
+    }
+
+    // The errors coalesced into the dump follow the elog of the request
+    for (const auto& path : ctx.paths)
+    {
+        auto elogId = std::filesystem::path(path).filename().string();
+        calls.push_back({"xyz.openbmc_project.Logging",
+                         path,
+                         "org.freedesktop.DBus.Properties",
+                         "GetAll",
+                         {"xyz.openbmc_project.Logging.Entry"},
+                         "elog-" + elogId + ".json"});
+    }
+    return calls;
+}
+
+/** @brief Snapshot of the settings objects */
+static std::vector<Call> snapshotSettings(const Context&)
+{
+    return {managedObjects("xyz.openbmc_project.Settings", "/",
+                           "settings.json")};
+}
+
+/** @brief Snapshot of the BIOS configuration objects */
+static std::vector<Call> snapshotBios(const Context&)
+{
+    return {managedObjects("xyz.openbmc_project.BIOSConfigManager", "/",
+                           "bios.json")};
+}
+
+/** @brief Snapshot of the LED group objects */
+static std::vector<Call> snapshotLedGroups(const Context&)
+{
+    return {managedObjects("xyz.openbmc_project.LED.GroupManager",
+                           "/xyz/openbmc_project/led/groups",
+                           "ledgroups.json")};
+}
+
+/** @brief Copy the persisted LED groups along the snapshot, as the dreport
+ *  plugin does
+ */
+static bool collectLedGroups(const Context& ctx)
+{
+    const std::filesystem::path persisted = "/var/lib/phosphor-led-manager";
+    std::error_code ec;
+    if (!std::filesystem::is_directory(persisted, ec))
+    {
+        return true;
+    }
+    std::filesystem::copy(persisted, ctx.dir / persisted.filename(),
+                          std::filesystem::copy_options::recursive, ec);
+    return !ec;
+}
+
+#ifdef BMC_DUMP_JOURNAL_INCREMENTAL
+/** @brief Export the journal entries since the previous dump, instead of
+ *  the whole journal in the JSON format of the dreport plugin.
+ */
+static bool collectJournal(const Context& ctx)
+{
+    try
+    {
+        auto count = journal::exportEntries(
+            ctx.dir / "journal.export", BMC_DUMP_JOURNAL_CURSOR_PATH,
+            {std::chrono::seconds(BMC_DUMP_JOURNAL_WINDOW),
+             BMC_DUMP_JOURNAL_MAX_SIZE * 1024,
+             std::chrono::seconds(BMC_DUMP_JOURNAL_OVERLAP)});
+        lg2::info("Exported {COUNT} journal entries", "COUNT", count);
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to export the journal, error: {ERROR}", "ERROR",
+                   e);
+        return false;
+    }
+}
+#endif
+
+/** @brief Native plugins, with the types of their dreport plugin config */
+static const std::vector<Plugin> plugins = {
+    {"osrelease",
+     {"core", "user", "elog", "checkstop", "ramoops"},
+     collectOsRelease},
+    {"uptime", {"core", "user", "elog"}, collectUptime},
+    {"meminfo", {"core", "user", "elog"}, collectMeminfo},
+    {"cpuinfo", {"core", "user", "elog"}, collectCpuinfo},
+    {"hostnamectl", {"core", "user", "elog", "checkstop"}, collectHostname},
+    {"bmcstate", {"core", "user", "elog", "checkstop"}, collectBmcState},
+    {"hoststate", {"core", "user", "elog", "checkstop"}, collectHostState},
+    {"chassisstate",
+     {"core", "user", "elog", "checkstop"},
+     collectChassisState},
+    {"inventory", {"user"}, nullptr, snapshotInventory},
+    {"elogall", {"user"}, nullptr, snapshotElogAll},
+    {"elog", {"elog", "checkstop"}, nullptr, snapshotElog},
+    {"settings", {"user", "elog", "checkstop"}, nullptr, snapshotSettings},
+    {"bios", {"user", "elog", "checkstop"}, nullptr, snapshotBios},
+    {"ledgroup", {"user"}, collectLedGroups, snapshotLedGroups},
+#ifdef BMC_DUMP_JOURNAL_INCREMENTAL
+    {"journalpretty", {"user", "checkstop"}, collectJournal},
+#endif
+};
+
+size_t collect(sdbusplus::bus_t& bus, const std::string& type,
+               const std::vector<std::string>& paths,
+               const std::filesystem::path& dir)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec)
+    {
+        lg2::error("Failed to create the native collection directory "
+                   "{PATH}, error: {ERROR}",
+                   "PATH", dir, "ERROR", ec.message());
+        return 0;
+    }
+
+    auto listFiles = [&dir]() {
+        std::set<std::filesystem::path> files;
+        for (const auto& file : std::filesystem::directory_iterator(dir))
+        {
+            files.insert(file.path());
+        }
+        return files;
+    };
+
+    std::vector<const Plugin*> selected;
+    std::vector<const Plugin*> snapshotted;
+    for (const auto& plugin : plugins)
+    {
+        if (std::ranges::find(plugin.types, type) == plugin.types.end())
+        {
+            continue;
+        }
+        selected.push_back(&plugin);
+        if (plugin.snapshot)
+        {
+            snapshotted.push_back(&plugin);
+        }
+    }
+
+    Context ctx{bus, paths, dir};
+    auto snapshots = takeSnapshots(ctx, snapshotted);
+
+    std::ofstream manifest(dir / nativePluginsFile);
+    size_t collected = 0;
+    for (const auto* plugin : selected)
+    {
+        auto snapshot = snapshots.find(plugin->name);
+        auto before = listFiles();
+        if ((plugin->snapshot && (snapshot == snapshots.end())) ||
+            (plugin->collect && !plugin->collect(ctx)))
+        {
+            // Leave it to the dreport plugin, without any partial output
+            lg2::info("Native collection of {PLUGIN} failed", "PLUGIN",
+                      plugin->name);
+            for (const auto& file : listFiles())
+            {
+                if (!before.contains(file))
+                {
+                    std::filesystem::remove_all(file, ec);
+                }
+            }
+            if (snapshot != snapshots.end())
+            {
+                for (const auto& file : snapshot->second)
+                {
+                    std::filesystem::remove(file, ec);
+                }
+            }
+            continue;
+        }
+        manifest << plugin->name << "\n";
+        collected++;
+    }
+    return collected;
+}
+
+} // namespace collector
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace collector
+{
+
+/** @brief Name of the file listing the natively collected plugins */
+constexpr auto nativePluginsFile = ".native_plugins";
+
+/** @brief Collect the data of the native plugins for a dump
+ *  @details The plugins which only read files or query a few D-Bus
+ *  properties are collected by the phosphor-dump-collector process the
+ *  dump manager launches in place of dreport, instead of spawning a shell
+ *  and the tools used by the dreport plugin. The output of
+ *  each plugin is written to dir with the file name used by the dreport
+ *  plugin, and the names of the collected plugins are written to the
+ *  nativePluginsFile in dir. dreport imports the directory and runs only
+ *  the plugins which are not listed, so a plugin failing to collect here
+ *  falls back to its shell version.
+ *
+ *  @param[in] bus - Bus to query the D-Bus services on.
+ *  @param[in] type - Dump collection type, as passed to dreport.
+ *  @param[in] paths - Optional path of the dump, as passed to dreport,
+ *                     followed by the paths of the error logs coalesced
+ *                     into the dump.
+ *  @param[in] dir - Directory to write the collected data to, created if
+ *                   it does not exist.
+ *  @return Number of plugins collected.
+ */
+size_t collect(sdbusplus::bus_t& bus, const std::string& type,
+               const std::vector<std::string>& paths,
+               const std::filesystem::path& dir);
+
+} // namespace collector
+} // namespace dump
+} // namespace phosphor
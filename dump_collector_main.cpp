@@ -0,0 +1,99 @@
+#include "config.h"
+
+#include "dump_collector.hpp"
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/bus.hpp>
+
+#include <cerrno>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/** @brief Collect the native plugins of a dump, then exec dreport.
+ *  @details The dump manager launches the collector in place of dreport:
+ *  phosphor-dump-collector -t <type> [-p <path>]... -d <dir> -- <dreport>
+ *  The paths after the first one are the error logs coalesced into the
+ *  dump, passed to dreport with -e. The data is collected on a bus
+ *  connection of this process, then the dreport command is executed in
+ *  this process, with -c <dir> if any plugin was collected, so the pid the
+ *  manager waits for is the one of dreport.
+ */
+int main(int argc, char** argv)
+{
+    std::string type;
+    std::vector<std::string> paths;
+    std::filesystem::path dir;
+
+    static const option options[] = {{"type", required_argument, nullptr, 't'},
+                                     {"path", required_argument, nullptr, 'p'},
+                                     {"dir", required_argument, nullptr, 'd'},
+                                     {nullptr, 0, nullptr, 0}};
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "+t:p:d:", options, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                type = optarg;
+                break;
+            case 'p':
+                paths.emplace_back(optarg);
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            default:
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> command(argv + optind, argv + argc);
+    if (command.empty())
+    {
+        lg2::error("No dreport command to run after the collection");
+        return EXIT_FAILURE;
+    }
+
+    size_t collected = 0;
+    if (!type.empty() && !dir.empty())
+    {
+        try
+        {
+            auto bus = sdbusplus::bus::new_default();
+            collected =
+                phosphor::dump::collector::collect(bus, type, paths, dir);
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Native collection failed, error: {ERROR}", "ERROR", e);
+        }
+    }
+
+    if (collected > 0)
+    {
+        command.insert(command.end(), {"-c", dir.string()});
+    }
+    else if (!dir.empty())
+    {
+        // dreport runs all the plugins
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    std::vector<char*> args;
+    for (auto& arg : command)
+    {
+        args.push_back(arg.data());
+    }
+    args.push_back(nullptr);
+
+    execv(args[0], args.data());
+
+    lg2::error("Failed to execute {COMMAND}, errno: {ERRNO}", "COMMAND",
+               command.front(), "ERRNO", errno);
+    return EXIT_FAILURE;
+}
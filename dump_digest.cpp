@@ -0,0 +1,99 @@
+#include "dump_digest.hpp"
+
+#include "dump_utils.hpp"
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <unistd.h>
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace digest
+{
+
+/** @brief Number of bytes read from the dump per hash update */
+constexpr auto readChunkSize = 128 * 1024;
+
+void Hasher::CtxDeleter::operator()(EVP_MD_CTX* ctx) const
+{
+    EVP_MD_CTX_free(ctx);
+}
+
+Hasher::Hasher() : ctx(EVP_MD_CTX_new())
+{
+    if (!ctx || (EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) != 1))
+    {
+        throw std::runtime_error("Failed to initialize the SHA-256 context");
+    }
+}
+
+void Hasher::update(const void* data, size_t size)
+{
+    if (EVP_DigestUpdate(ctx.get(), data, size) != 1)
+    {
+        throw std::runtime_error("Failed to update the SHA-256 digest");
+    }
+}
+
+std::string Hasher::final()
+{
+    std::array<unsigned char, EVP_MAX_MD_SIZE> md;
+    unsigned int mdLength = 0;
+    if (EVP_DigestFinal_ex(ctx.get(), md.data(), &mdLength) != 1)
+    {
+        throw std::runtime_error("Failed to finalize the SHA-256 digest");
+    }
+
+    constexpr auto hexDigits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(mdLength * 2);
+    for (unsigned int i = 0; i < mdLength; i++)
+    {
+        hex += hexDigits[md[i] >> 4];
+        hex += hexDigits[md[i] & 0x0f];
+    }
+    return hex;
+}
+
+std::string sha256(const std::filesystem::path& file)
+{
+    CustomFd fd(open(file.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd() < 0)
+    {
+        throw std::runtime_error("Failed to open " + file.string() +
+                                 ", errno: " + std::to_string(errno));
+    }
+    posix_fadvise(fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    Hasher hasher;
+    std::vector<char> buffer(readChunkSize);
+    while (true)
+    {
+        auto count = read(fd(), buffer.data(), buffer.size());
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("Failed to read " + file.string() +
+                                     ", errno: " + std::to_string(errno));
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        hasher.update(buffer.data(), count);
+    }
+    return hasher.final();
+}
+
+} // namespace digest
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+struct evp_md_ctx_st;
+
+namespace phosphor
+{
+namespace dump
+{
+namespace digest
+{
+
+/** @class Hasher
+ *  @brief Incremental SHA-256 digest, for data read piece by piece.
+ */
+class Hasher
+{
+  public:
+    Hasher(const Hasher&) = delete;
+    Hasher& operator=(const Hasher&) = delete;
+    Hasher(Hasher&&) = default;
+    Hasher& operator=(Hasher&&) = default;
+    ~Hasher() = default;
+
+    /** @brief Initialize the digest
+     *  @throws std::runtime_error if the digest can not be initialized.
+     */
+    Hasher();
+
+    /** @brief Hash the next bytes
+     *  @param[in] data - bytes to hash.
+     *  @param[in] size - number of bytes.
+     *  @throws std::runtime_error if the digest can not be updated.
+     */
+    void update(const void* data, size_t size);
+
+    /** @brief Finalize the digest
+     *  @return Lower case hex encoded digest.
+     *  @throws std::runtime_error if the digest can not be finalized.
+     */
+    std::string final();
+
+  private:
+    struct CtxDeleter
+    {
+        void operator()(evp_md_ctx_st* ctx) const;
+    };
+
+    /** @brief OpenSSL digest context */
+    std::unique_ptr<evp_md_ctx_st, CtxDeleter> ctx;
+};
+
+/** @brief Compute the SHA-256 digest of a file.
+ *  @details The file is read sequentially in fixed size chunks, so the
+ *  memory used does not depend on the size of the dump.
+ *  @param[in] file - path of the file to hash.
+ *  @return Lower case hex encoded digest.
+ *
+ *  @throws std::runtime_error if the file can not be read or hashed.
+ */
+std::string sha256(const std::filesystem::path& file);
+
+} // namespace digest
+} // namespace dump
+} // namespace phosphor
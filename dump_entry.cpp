@@ -37,13 +37,7 @@ sdbusplus::message::unix_fd Entry::getFileHandle()
         elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
     }
 
-    if (fdCloseEventSource)
-    {
-        // Return the existing file descriptor
-        return fdCloseEventSource->first;
-    }
-
-    int fd = open(file.c_str(), O_RDONLY | O_NONBLOCK);
+    int fd = open(file.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
     if (fd == -1)
     {
         auto err = errno;
@@ -52,17 +46,22 @@ sdbusplus::message::unix_fd Entry::getFileHandle()
         elog<Open>(metadata::ERRNO(err), metadata::PATH(file.c_str()));
     }
 
-    // Create a new Defer event source for closing this fd
-    sdeventplus::Event event = sdeventplus::Event::get_default();
-    auto eventSource = std::make_unique<sdeventplus::source::Defer>(
-        event, [this](auto& /*source*/) { closeFD(); });
-
-    // Store the file descriptor and event source in the optional pair
-    fdCloseEventSource = std::make_pair(fd, std::move(eventSource));
-
+    deferCloseFD(fd);
     return fd;
 }
 
+void Entry::deferCloseFD(int fd)
+{
+    replyFDs.push_back(fd);
+    if (!fdCloseEventSource)
+    {
+        // Create a new Defer event source for closing the fds
+        sdeventplus::Event event = sdeventplus::Event::get_default();
+        fdCloseEventSource = std::make_unique<sdeventplus::source::Defer>(
+            event, [this](auto& /*source*/) { closeFD(); });
+    }
+}
+
 void Entry::serialize(const std::filesystem::path& filePath)
 {
     try
@@ -78,9 +77,11 @@ void Entry::serialize(const std::filesystem::path& filePath)
         {
             lg2::error("Failed to open file for serialization: {PATH} ", "PATH",
                        filePath);
+            return;
         }
         cereal::BinaryOutputArchive archive(os);
         archive(originatorId(), originatorType(), startTime());
+        serializeExtra(archive);
     }
     catch (const std::exception& e)
     {
@@ -98,6 +99,7 @@ void Entry::deserialize(const std::filesystem::path& filePath)
         {
             lg2::error("Failed to open file for deserialization: {PATH}",
                        "PATH", filePath);
+            return;
         }
         cereal::BinaryInputArchive archive(is);
         std::string originId;
@@ -107,6 +109,7 @@ void Entry::deserialize(const std::filesystem::path& filePath)
         originatorId(originId);
         originatorType(originType);
         startTime(startTimeValue);
+        deserializeExtra(archive);
     }
     catch (const std::exception& e)
     {
@@ -16,6 +16,8 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 namespace phosphor
 {
@@ -123,6 +125,8 @@ class Entry : public EntryIfaces
     }
 
     /** @brief Method to get the file handle of the dump
+     *  @details Every call opens a new file descriptor, so each caller has
+     *  its own file offset.
      *  @returns A Unix file descriptor to the dump file
      *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Open on
      *  failure to open the file
@@ -133,6 +137,8 @@ class Entry : public EntryIfaces
 
     /**
      * @brief Serialize the dump entry attributes to a file.
+     * @details The attributes of a derived entry are written after the
+     * common ones by serializeExtra.
      *
      * @param[in] filePath - The path to the file where the entry will be
      *                       serialized.
@@ -148,6 +154,17 @@ class Entry : public EntryIfaces
     virtual void deserialize(const std::filesystem::path& filePath);
 
   protected:
+    /** @brief Serialize the attributes a derived entry adds
+     *  @param[in] archive - archive the common attributes were written to
+     */
+    virtual void serializeExtra(cereal::BinaryOutputArchive& /*archive*/) {}
+
+    /** @brief Deserialize the attributes a derived entry adds
+     *  @details The file may have been written by a version without them.
+     *  @param[in] archive - archive the common attributes were read from
+     */
+    virtual void deserializeExtra(cereal::BinaryInputArchive& /*archive*/) {}
+
     /** @brief This entry's parent */
     Manager& parent;
 
@@ -157,23 +174,32 @@ class Entry : public EntryIfaces
     /** @Dump file name */
     std::filesystem::path file;
 
+    /** @brief Close a file descriptor once the method reply carrying it
+     *  was sent. The reply holds its own duplicate of the descriptor.
+     *  @param[in] fd - file descriptor to close
+     */
+    void deferCloseFD(int fd);
+
   private:
-    /** @brief Closes the file descriptor and removes the corresponding event
-     *  source.
+    /** @brief Closes the file descriptors and removes the corresponding
+     *  event source.
      *
      */
     void closeFD()
     {
-        if (fdCloseEventSource)
+        for (auto fd : replyFDs)
         {
-            close(fdCloseEventSource->first);
-            fdCloseEventSource.reset();
+            close(fd);
         }
+        replyFDs.clear();
+        fdCloseEventSource.reset();
     }
 
-    /* @brief A pair of file descriptor and corresponding event source. */
-    std::optional<std::pair<int, std::unique_ptr<sdeventplus::source::Defer>>>
-        fdCloseEventSource;
+    /* @brief File descriptors handed out in method replies. */
+    std::vector<int> replyFDs;
+
+    /* @brief Event source closing the handed out file descriptors. */
+    std::unique_ptr<sdeventplus::source::Defer> fdCloseEventSource;
 };
 
 } // namespace dump
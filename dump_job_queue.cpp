@@ -0,0 +1,101 @@
+#include "dump_job_queue.hpp"
+
+#include <algorithm>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace bmc
+{
+
+Job JobQueue::make(uint32_t id, DumpTypes type, const std::string& errorType,
+                   JobPriority priority, const std::string& path,
+                   Clock::time_point now) const
+{
+    Job job{id, type, errorType, priority, {path}, now};
+    if (priority == JobPriority::Elog)
+    {
+        job.startTime += window;
+    }
+    return job;
+}
+
+std::optional<uint32_t> JobQueue::fold(DumpTypes type,
+                                       const std::string& errorType,
+                                       JobPriority priority,
+                                       const std::string& path,
+                                       Clock::time_point now)
+{
+    for (auto& job : jobs)
+    {
+        if ((job.type != type) || (job.errorType != errorType))
+        {
+            continue;
+        }
+        if ((job.paths.size() == 1) && (job.paths.front() == path))
+        {
+            return job.id;
+        }
+        if ((priority == JobPriority::Elog) &&
+            (job.priority == JobPriority::Elog) && !path.empty() &&
+            (now < job.startTime))
+        {
+            job.paths.push_back(path);
+            return job.id;
+        }
+    }
+    return std::nullopt;
+}
+
+bool JobQueue::coalescing(const std::string& errorType,
+                          Clock::time_point now) const
+{
+    return std::ranges::any_of(jobs, [&](const Job& job) {
+        return (job.priority == JobPriority::Elog) &&
+               (job.errorType == errorType) && (now < job.startTime);
+    });
+}
+
+void JobQueue::push(Job job)
+{
+    jobs.push_back(std::move(job));
+}
+
+std::optional<Job> JobQueue::pop(Clock::time_point now)
+{
+    auto next = jobs.end();
+    for (auto it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        if ((it->startTime <= now) &&
+            ((next == jobs.end()) || (it->priority > next->priority)))
+        {
+            next = it;
+        }
+    }
+    if (next == jobs.end())
+    {
+        return std::nullopt;
+    }
+    auto job = std::move(*next);
+    jobs.erase(next);
+    return job;
+}
+
+std::optional<JobQueue::Clock::time_point>
+    JobQueue::nextStart(Clock::time_point now) const
+{
+    std::optional<Clock::time_point> wakeTime;
+    for (const auto& job : jobs)
+    {
+        if ((job.startTime > now) && (!wakeTime || (job.startTime < *wakeTime)))
+        {
+            wakeTime = job.startTime;
+        }
+    }
+    return wakeTime;
+}
+
+} // namespace bmc
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "dump_types.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace bmc
+{
+
+/** @brief Priority classes of the dump requests, the higher classes are
+ *  started first */
+enum class JobPriority
+{
+    User,
+    Elog,
+    Core
+};
+
+/** @struct Job
+ *  @brief Dump request waiting for dreport to be started
+ */
+struct Job
+{
+    /** @brief Id of the dump entry */
+    uint32_t id;
+
+    /** @brief Type of the dump */
+    DumpTypes type;
+
+    /** @brief Error type of an error log dump, empty for the other dumps */
+    std::string errorType;
+
+    /** @brief Priority class of the request */
+    JobPriority priority;
+
+    /** @brief Paths passed to dreport, the paths of the requests coalesced
+     *  into the job follow the path of the first request */
+    std::vector<std::string> paths;
+
+    /** @brief Time the job can start at, the end of its coalescing window */
+    std::chrono::steady_clock::time_point startTime;
+};
+
+/** @class JobQueue
+ *  @brief Dump requests waiting for dreport to be started
+ *  @details The requests folded into a queued job share its dump entry,
+ *  which is completed or failed with the job.
+ */
+class JobQueue
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    JobQueue() = delete;
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+    JobQueue(JobQueue&&) = delete;
+    JobQueue& operator=(JobQueue&&) = delete;
+    ~JobQueue() = default;
+
+    /** @brief Constructor
+     *  @param[in] window - time the error log dumps wait for more errors of
+     *                      the same type
+     */
+    explicit JobQueue(std::chrono::seconds window) : window(window) {}
+
+    /** @brief Build the job of a request, an error log dump starts at the
+     *  end of its coalescing window
+     *  @param[in] id - id of the dump entry
+     *  @param[in] type - type of the dump
+     *  @param[in] errorType - error type of an error log dump
+     *  @param[in] priority - priority class of the request
+     *  @param[in] path - path passed to dreport
+     *  @param[in] now - time of the request
+     *  @return The job
+     */
+    Job make(uint32_t id, DumpTypes type, const std::string& errorType,
+             JobPriority priority, const std::string& path,
+             Clock::time_point now) const;
+
+    /** @brief Fold a request into an identical queued request, or into the
+     *  error log dump of the same error type within its coalescing window
+     *  @param[in] type - type of the dump
+     *  @param[in] errorType - error type of an error log dump
+     *  @param[in] priority - priority class of the request
+     *  @param[in] path - path passed to dreport
+     *  @param[in] now - time of the request
+     *  @return Id of the job the request was folded into, none when it has
+     *  to be queued
+     */
+    std::optional<uint32_t> fold(DumpTypes type, const std::string& errorType,
+                                 JobPriority priority, const std::string& path,
+                                 Clock::time_point now);
+
+    /** @brief Whether an error log dump of the error type is in its
+     *  coalescing window
+     *  @param[in] errorType - error type of the request
+     *  @param[in] now - time of the request
+     */
+    bool coalescing(const std::string& errorType,
+                    Clock::time_point now) const;
+
+    /** @brief Queue a job */
+    void push(Job job);
+
+    /** @brief Take the oldest ready job of the highest priority class
+     *  @param[in] now - current time
+     *  @return The job, none when no job is ready
+     */
+    std::optional<Job> pop(Clock::time_point now);
+
+    /** @brief End of the first coalescing window still running
+     *  @param[in] now - current time
+     */
+    std::optional<Clock::time_point> nextStart(Clock::time_point now) const;
+
+    /** @brief Number of queued jobs */
+    size_t size() const
+    {
+        return jobs.size();
+    }
+
+  private:
+    /** @brief Time the error log dumps wait for more errors */
+    std::chrono::seconds window;
+
+    /** @brief Queued jobs, oldest first */
+    std::vector<Job> jobs;
+};
+
+} // namespace bmc
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,253 @@
+#include "dump_journal.hpp"
+
+#include <systemd/sd-journal.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace journal
+{
+
+struct JournalCloser
+{
+    void operator()(sd_journal* journal) const
+    {
+        sd_journal_close(journal);
+    }
+};
+using JournalPtr = std::unique_ptr<sd_journal, JournalCloser>;
+
+/** @brief Throw a std::runtime_error if an sd-journal call failed */
+static void check(int r, const std::string& what)
+{
+    if (r < 0)
+    {
+        throw std::runtime_error("Failed to " + what +
+                                 ", error: " + std::strerror(-r));
+    }
+}
+
+/** @brief Cursor of the current entry */
+static std::string getCursor(sd_journal* journal)
+{
+    char* cursor = nullptr;
+    check(sd_journal_get_cursor(journal, &cursor), "get the journal cursor");
+    std::string value(cursor);
+    free(cursor);
+    return value;
+}
+
+/** @brief Realtime timestamp in microseconds of the current entry */
+static uint64_t getRealtime(sd_journal* journal)
+{
+    uint64_t usec = 0;
+    check(sd_journal_get_realtime_usec(journal, &usec),
+          "get the journal entry time");
+    return usec;
+}
+
+/** @brief Whether a field value has to be serialized in the binary form of
+ *  the export format.
+ */
+static bool isBinary(const char* value, size_t length)
+{
+    return std::any_of(value, value + length, [](char c) {
+        auto u = static_cast<unsigned char>(c);
+        return ((u < ' ') && (u != '\t')) || (u == 0x7f);
+    });
+}
+
+/** @brief Serialize the current entry in the journal export format, as
+ *  written by "journalctl -o export".
+ *  @param[in] journal - journal positioned on the entry.
+ *  @param[out] entry - serialized entry.
+ */
+static void formatEntry(sd_journal* journal, std::string& entry)
+{
+    uint64_t monotonic = 0;
+    sd_id128_t bootId;
+    check(sd_journal_get_monotonic_usec(journal, &monotonic, &bootId),
+          "get the journal entry monotonic time");
+    char bootIdString[SD_ID128_STRING_MAX];
+
+    entry = "__CURSOR=" + getCursor(journal) + "\n";
+    entry += "__REALTIME_TIMESTAMP=" + std::to_string(getRealtime(journal)) +
+             "\n";
+    entry += "__MONOTONIC_TIMESTAMP=" + std::to_string(monotonic) + "\n";
+    entry += "_BOOT_ID=";
+    entry += sd_id128_to_string(bootId, bootIdString);
+    entry += "\n";
+
+    const void* data = nullptr;
+    size_t length = 0;
+    SD_JOURNAL_FOREACH_DATA(journal, data, length)
+    {
+        std::string_view field(static_cast<const char*>(data), length);
+        if (field.starts_with("_BOOT_ID="))
+        {
+            continue;
+        }
+        auto separator = field.find('=');
+        if (separator == std::string_view::npos)
+        {
+            continue;
+        }
+        auto value = field.substr(separator + 1);
+        if (!isBinary(value.data(), value.size()))
+        {
+            entry += field;
+            entry += '\n';
+            continue;
+        }
+
+        // Binary field: name, new line, little endian 64 bit size, value
+        entry += field.substr(0, separator);
+        entry += '\n';
+        uint64_t size = value.size();
+        for (int i = 0; i < 8; i++)
+        {
+            entry += static_cast<char>((size >> (i * 8)) & 0xff);
+        }
+        entry += value;
+        entry += '\n';
+    }
+    entry += '\n';
+}
+
+/** @brief Read the cursor saved by the previous export */
+static std::string readCursor(const std::filesystem::path& cursorFile)
+{
+    std::string cursor;
+    std::ifstream in(cursorFile);
+    std::getline(in, cursor);
+    return cursor;
+}
+
+/** @brief Save the cursor of the newest exported entry */
+static void saveCursor(const std::filesystem::path& cursorFile,
+                       const std::string& cursor)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cursorFile.parent_path(), ec);
+
+    auto tmpFile = cursorFile;
+    tmpFile += ".tmp";
+    std::ofstream out(tmpFile);
+    out << cursor << std::endl;
+    out.close();
+    if (out.fail())
+    {
+        lg2::error("Failed to write the journal cursor {PATH}", "PATH",
+                   tmpFile);
+        return;
+    }
+    std::filesystem::rename(tmpFile, cursorFile, ec);
+    if (ec)
+    {
+        lg2::error("Failed to save the journal cursor {PATH}, error: {ERROR}",
+                   "PATH", cursorFile, "ERROR", ec.message());
+    }
+}
+
+size_t exportEntries(const std::filesystem::path& file,
+                     const std::filesystem::path& cursorFile,
+                     const Bounds& bounds)
+{
+    using namespace std::chrono;
+
+    sd_journal* raw = nullptr;
+    check(sd_journal_open(&raw, SD_JOURNAL_LOCAL_ONLY), "open the journal");
+    JournalPtr journal(raw);
+    check(sd_journal_set_data_threshold(journal.get(), 0),
+          "set the journal data threshold");
+
+    auto now = duration_cast<microseconds>(
+                   system_clock::now().time_since_epoch())
+                   .count();
+    uint64_t start = std::max<int64_t>(
+        now - duration_cast<microseconds>(bounds.window).count(), 0);
+
+    // Continue from the previous export, if its entry was not rotated out
+    auto previous = readCursor(cursorFile);
+    if (!previous.empty() &&
+        (sd_journal_seek_cursor(journal.get(), previous.c_str()) >= 0) &&
+        (sd_journal_next(journal.get()) > 0) &&
+        (sd_journal_test_cursor(journal.get(), previous.c_str()) > 0))
+    {
+        int64_t since = getRealtime(journal.get()) -
+                        duration_cast<microseconds>(bounds.overlap).count();
+        start = std::max<uint64_t>(start, std::max<int64_t>(since, 0));
+    }
+
+    // Walk back from the newest entry to find the oldest entry which fits
+    std::string entry;
+    std::string first;
+    std::string last;
+    size_t size = 0;
+    size_t count = 0;
+    check(sd_journal_seek_tail(journal.get()), "seek the journal tail");
+    while (sd_journal_previous(journal.get()) > 0)
+    {
+        if (getRealtime(journal.get()) < start)
+        {
+            break;
+        }
+        formatEntry(journal.get(), entry);
+        if (size + entry.size() > bounds.maxSize)
+        {
+            break;
+        }
+        size += entry.size();
+        count++;
+        first = getCursor(journal.get());
+        if (last.empty())
+        {
+            last = first;
+        }
+    }
+
+    std::ofstream out(file, std::ios::binary);
+    if (!out.is_open())
+    {
+        throw std::runtime_error("Failed to create " + file.string());
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    check(sd_journal_seek_cursor(journal.get(), first.c_str()),
+          "seek the journal cursor");
+    size_t exported = 0;
+    while ((exported < count) && (sd_journal_next(journal.get()) > 0))
+    {
+        formatEntry(journal.get(), entry);
+        out.write(entry.data(), entry.size());
+        exported++;
+    }
+    out.close();
+    if (out.fail())
+    {
+        throw std::runtime_error("Failed to write " + file.string());
+    }
+
+    saveCursor(cursorFile, last);
+    return exported;
+}
+
+} // namespace journal
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace journal
+{
+
+/** @struct Bounds
+ *  @brief Limits of the journal entries exported to a dump
+ */
+struct Bounds
+{
+    /** @brief Age of the oldest entry exported */
+    std::chrono::seconds window;
+
+    /** @brief Maximum size in bytes of the export, the newest entries are
+     *  kept when the entries of the window do not fit */
+    size_t maxSize;
+
+    /** @brief Time before the entry of the previous dump the export starts
+     *  at, so that the dumps overlap */
+    std::chrono::seconds overlap;
+};
+
+/** @brief Export the journal entries in the journal export format.
+ *  @details The entries are read with the sd-journal API, from the oldest
+ *  entry of the window to the newest entry, up to the size limit. The cursor
+ *  of the newest exported entry is saved to cursorFile, the next export
+ *  starts from the entry of the saved cursor, less the overlap, instead of
+ *  the start of the window.
+ *
+ *  @param[in] file - path of the export file to create.
+ *  @param[in] cursorFile - path of the cursor of the previous export.
+ *  @param[in] bounds - time window and size of the export.
+ *  @return Number of entries exported.
+ *
+ *  @throws std::runtime_error if the journal can not be read or the export
+ *  file can not be written.
+ */
+size_t exportEntries(const std::filesystem::path& file,
+                     const std::filesystem::path& cursorFile,
+                     const Bounds& bounds);
+
+} // namespace journal
+} // namespace dump
+} // namespace phosphor
@@ -52,12 +52,18 @@ class Manager : public Iface
      */
     virtual void restore() = 0;
 
+    /** @brief Notify that the properties of an entry changed
+     *
+     * @param[in] entryId - unique identifier of the entry
+     */
+    virtual void entryUpdated(uint32_t /*entryId*/) {}
+
   protected:
     /** @brief Erase specified entry d-bus object
      *
      * @param[in] entryId - unique identifier of the entry
      */
-    void erase(uint32_t entryId);
+    virtual void erase(uint32_t entryId);
 
     /** @brief  Erase all BMC dump entries and  Delete all Dump files
      * from Permanent location
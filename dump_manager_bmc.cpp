@@ -3,11 +3,16 @@
 #include "dump_manager_bmc.hpp"
 
 #include "bmc_dump_entry.hpp"
+#include "dump_store.hpp"
 #include "dump_types.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 #include "xyz/openbmc_project/Dump/Create/error.hpp"
 
+#include <linux/ioprio.h>
+#include <spawn.h>
 #include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <systemd/sd-event.h>
 #include <unistd.h>
 
 #include <phosphor-logging/elog-errors.hpp>
@@ -16,9 +21,13 @@
 #include <sdeventplus/exception.hpp>
 #include <sdeventplus/source/base.hpp>
 
+#include <chrono>
 #include <cmath>
+#include <csignal>
 #include <ctime>
 #include <regex>
+#include <string>
+#include <vector>
 
 namespace phosphor
 {
@@ -30,7 +39,8 @@ namespace bmc
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
 using namespace phosphor::logging;
 
-bool Manager::fUserDumpInProgress = false;
+/** @brief Directory of the dump archive frame store, in the dump directory */
+constexpr auto storeDir = ".store";
 constexpr auto BMC_DUMP = "BMC_DUMP";
 
 sdbusplus::message::object_path
@@ -58,23 +68,81 @@ sdbusplus::message::object_path
         dumpType = validateDumpType(type, BMC_DUMP);
     }
 
+    std::string errorType;
     if (dumpType == DumpTypes::ELOG)
     {
         dumpType = getErrorDumpType(params);
+        errorType = extractParameter<std::string>(
+            convertCreateParametersToString(CreateParameters::ErrorType),
+            params);
     }
     std::string path = extractParameter<std::string>(
         convertCreateParametersToString(CreateParameters::FilePath), params);
 
-    if ((Manager::fUserDumpInProgress == true) && (dumpType == DumpTypes::USER))
+    auto priority = JobPriority::Elog;
+    if (dumpType == DumpTypes::USER)
+    {
+        priority = JobPriority::User;
+    }
+    else if ((dumpType == DumpTypes::CORE) || (dumpType == DumpTypes::RAMOOPS))
+    {
+        priority = JobPriority::Core;
+    }
+
+#ifdef BMC_DUMP_SINGLE_USER
+    if ((dumpType == DumpTypes::USER) && userDumpId)
     {
         lg2::info("Another user initiated dump in progress");
         elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
     }
+#endif
 
-    lg2::info("Initiating new BMC dump with type: {TYPE} path: {PATH}", "TYPE",
-              dumpTypeToString(dumpType).value(), "PATH", path);
+    // Fold the request into an identical request waiting to start, or into
+    // a request for the same error type within its coalescing window. The
+    // folded request shares the dump entry of the queued request.
+    auto now = std::chrono::steady_clock::now();
+    if (auto id = jobs.fold(dumpType, errorType, priority, path, now))
+    {
+        lg2::info("Dump request {PATH} folded into the pending dump {ID}",
+                  "PATH", path, "ID", *id);
+        return (std::filesystem::path(baseEntryPath) / std::to_string(*id))
+            .string();
+    }
 
-    auto id = captureDump(dumpType, path);
+    if (jobs.size() >= BMC_DUMP_MAX_QUEUED_JOBS)
+    {
+        lg2::error("Too many dump requests pending, rejecting the request "
+                   "with type: {TYPE}",
+                   "TYPE", dumpTypeToString(dumpType).value());
+        elog<sdbusplus::xyz::openbmc_project::Common::Error::Unavailable>();
+    }
+
+    makeSpace();
+
+    auto job = jobs.make(lastEntryId + 1, dumpType, errorType, priority, path,
+                         now);
+
+    // Start the dump right away when possible, so that the errors to launch
+    // dreport are returned to the caller. A dump waiting for the deleted
+    // dumps to be removed is started once the reaper released their space.
+    if ((job.startTime <= now) && (childPtrMap.size() < BMC_DUMP_MAX_JOBS) &&
+        spaceReady())
+    {
+        lg2::info("Initiating new BMC dump with type: {TYPE} path: {PATH}",
+                  "TYPE", dumpTypeToString(dumpType).value(), "PATH", path);
+        captureDump(job.id, dumpType, job.paths);
+    }
+    else
+    {
+        lg2::info("Queuing new BMC dump with type: {TYPE} path: {PATH}",
+                  "TYPE", dumpTypeToString(dumpType).value(), "PATH", path);
+        jobs.push(job);
+    }
+    auto id = ++lastEntryId;
+    if (dumpType == DumpTypes::USER)
+    {
+        userDumpId = id;
+    }
 
     // Entry Object path.
     auto objPath = std::filesystem::path(baseEntryPath) / std::to_string(id);
@@ -90,7 +158,7 @@ sdbusplus::message::object_path
             id, std::make_unique<bmc::Entry>(
                     bus, objPath.c_str(), id, timeStamp, 0, std::string(),
                     phosphor::dump::OperationStatus::InProgress, originatorId,
-                    originatorType, *this)));
+                    originatorType, *this, offloadScheduler)));
     }
     catch (const std::invalid_argument& e)
     {
@@ -100,47 +168,300 @@ sdbusplus::message::object_path
         elog<InternalFailure>();
     }
 
-    if (dumpType == DumpTypes::USER)
+    // Arm the timer of the coalescing window of a queued job
+    startJobs();
+
+    return objPath.string();
+}
+
+void Manager::startJobs()
+{
+    auto now = std::chrono::steady_clock::now();
+    while ((childPtrMap.size() < BMC_DUMP_MAX_JOBS) && spaceReady())
     {
-        Manager::fUserDumpInProgress = true;
+        auto job = jobs.pop(now);
+        if (!job)
+        {
+            break;
+        }
+
+        lg2::info("Initiating queued BMC dump {ID} with type: {TYPE}", "ID",
+                  job->id, "TYPE", dumpTypeToString(job->type).value());
+        try
+        {
+            captureDump(job->id, job->type, job->paths);
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Failed to start the queued dump {ID}, error: {ERROR}",
+                       "ID", job->id, "ERROR", e);
+            failJob(job->id);
+        }
     }
-    return objPath.string();
+
+    // Wake up at the end of the first coalescing window, the jobs waiting
+    // for dreport to complete are started when it does
+    auto wakeTime = jobs.nextStart(now);
+    if (wakeTime && (childPtrMap.size() < BMC_DUMP_MAX_JOBS))
+    {
+        jobTimer.restartOnce(
+            std::chrono::duration_cast<JobTimer::Duration>(*wakeTime - now));
+    }
+    else
+    {
+        jobTimer.setEnabled(false);
+    }
+}
+
+bool Manager::coalescing(const std::string& errorType) const
+{
+    return jobs.coalescing(errorType, std::chrono::steady_clock::now());
 }
 
-uint32_t Manager::captureDump(DumpTypes type, const std::string& path)
+void Manager::dumpSuppressed(const std::string& errorType)
+{
+    suppressedDumps(suppressedDumps() + 1);
+    auto byType = suppressedDumpsByType();
+    byType[errorType]++;
+    suppressedDumpsByType(byType);
+}
+
+void Manager::failJob(uint32_t id)
+{
+    if (userDumpId == id)
+    {
+        userDumpId.reset();
+    }
+    auto entry = entries.find(id);
+    if ((entry != entries.end()) &&
+        (entry->second->status() == phosphor::dump::OperationStatus::InProgress))
+    {
+        entry->second->status(phosphor::dump::OperationStatus::Failed);
+    }
+}
+
+/** @brief Launch dreport without duplicating the dump manager process
+ *  @details posix_spawn() runs the child on the address space of the
+ *  manager until it execs, so no page tables are copied and no copy on
+ *  write faults are taken however many entries the manager holds. The
+ *  child starts with an empty signal mask and the default SIGCHLD and
+ *  SIGPIPE actions, and inherits only stdin, stdout and stderr.
+ *  @param[in] args - command to run, starting with the absolute path of
+ *                    the program
+ *  @return pid of the dreport process, or -1 with errno set on failure
+ *  to launch, including failure to exec dreport.
+ */
+static pid_t spawnDreport(const std::vector<std::string>& args)
+{
+    std::vector<char*> argv;
+    for (const auto& arg : args)
+    {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    sigset_t emptyMask;
+    sigset_t defaultSignals;
+    sigemptyset(&emptyMask);
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGCHLD);
+    sigaddset(&defaultSignals, SIGPIPE);
+
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_init(&actions);
+
+    int rc = posix_spawnattr_setflags(
+        &attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    if (rc == 0)
+    {
+        rc = posix_spawnattr_setsigmask(&attr, &emptyMask);
+    }
+    if (rc == 0)
+    {
+        rc = posix_spawnattr_setsigdefault(&attr, &defaultSignals);
+    }
+    if (rc == 0)
+    {
+        rc = posix_spawn_file_actions_addclosefrom_np(&actions,
+                                                      STDERR_FILENO + 1);
+    }
+
+    pid_t pid = -1;
+    if (rc == 0)
+    {
+        rc = posix_spawn(&pid, argv[0], &actions, &attr, argv.data(),
+                         environ);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (rc != 0)
+    {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+
+/** @brief Build the command running dreport with the resources of a dump
+ *  type.
+ *  @details The cgroup limits and the nice level are applied by running
+ *  dreport in a transient systemd scope. In scope mode systemd-run execs
+ *  dreport itself, so the launched pid stays the one of dreport.
+ *  @param[in] resources - resources of the dump type
+ *  @param[in] args - dreport command
+ *  @return The command to launch
+ */
+static std::vector<std::string> dreportCommand(const DumpResources& resources,
+                                               std::vector<std::string> args)
+{
+    std::vector<std::string> command;
+    if (resources.cpuWeight)
+    {
+        command.push_back("--property=CPUWeight=" +
+                          std::to_string(*resources.cpuWeight));
+    }
+    if (resources.ioWeight)
+    {
+        command.push_back("--property=IOWeight=" +
+                          std::to_string(*resources.ioWeight));
+    }
+    if (resources.memoryMax)
+    {
+        command.push_back("--property=MemoryMax=" + *resources.memoryMax);
+    }
+    if (resources.nice)
+    {
+        command.push_back("--nice=" + std::to_string(*resources.nice));
+    }
+    if (command.empty())
+    {
+        return args;
+    }
+
+    command.insert(command.begin(), {"/usr/bin/systemd-run", "--scope",
+                                     "--quiet", "--collect"});
+    command.insert(command.end(), args.begin(), args.end());
+    return command;
+}
+
+/** @brief Set the I/O priority of the dump manager
+ *  @param[in] ioPriority - I/O priority, as built by IOPRIO_PRIO_VALUE
+ *  @return The previous I/O priority, -1 on failure.
+ */
+static int setIoPriority(int ioPriority)
+{
+    int previous = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+    if ((previous < 0) ||
+        (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioPriority) < 0))
+    {
+        lg2::error("Unable to set the I/O priority, errno: {ERRNO}", "ERRNO",
+                   errno);
+        return -1;
+    }
+    return previous;
+}
+
+void Manager::captureDump(uint32_t dumpId, DumpTypes type,
+                          const std::vector<std::string>& paths)
 {
     // Get Dump size.
     auto size = getAllowedSize();
 
-    pid_t pid = fork();
+    std::filesystem::path dumpPath(dumpDir);
+    auto id = std::to_string(dumpId);
+    dumpPath /= id;
+
+    auto strType = dumpTypeToString(type).value();
+    const auto& path = paths.front();
+
+    std::vector<std::string> args{"/usr/bin/dreport", "-d", dumpPath, "-i",
+                                  id, "-s", std::to_string(size), "-q", "-v",
+                                  "-p", path, "-t", strType,
+                                  "-C", BMC_DUMP_CACHE_PATH};
+    // The error logs coalesced into the dump
+    for (auto it = std::next(paths.begin()); it != paths.end(); ++it)
+    {
+        args.insert(args.end(), {"-e", *it});
+    }
+#ifdef BMC_DUMP_DEDUP
+    args.emplace_back("-D");
+#endif
+
+    auto archive = getDumpArchive(type);
+    args.insert(args.end(), {"-z", archive.codec});
+    if (archive.level)
+    {
+        args.insert(args.end(), {"-l", std::to_string(*archive.level)});
+    }
+    if (archive.threads)
+    {
+        args.insert(args.end(), {"-T", std::to_string(*archive.threads)});
+    }
 
-    if (pid == 0)
+#ifdef BMC_DUMP_NATIVE_COLLECTOR
+    // The plugins implemented natively are collected by the collector
+    // process, which then execs dreport with the collected data, so no bus
+    // call is made on the event loop of the manager. The collector gets all
+    // the paths, to snapshot each error log coalesced into the dump.
+    auto nativeDir = std::filesystem::path(BMC_DUMP_NATIVE_COLLECTOR_PATH) /
+                     ("obmcdump_" + id);
+    std::vector<std::string> collectorArgs{"/usr/bin/phosphor-dump-collector",
+                                           "-t", strType};
+    for (const auto& optionalPath : paths)
     {
-        std::filesystem::path dumpPath(dumpDir);
-        auto id = std::to_string(lastEntryId + 1);
-        dumpPath /= id;
+        collectorArgs.insert(collectorArgs.end(), {"-p", optionalPath});
+    }
+    collectorArgs.insert(collectorArgs.end(), {"-d", nativeDir, "--"});
+    args.insert(args.begin(), collectorArgs.begin(), collectorArgs.end());
+#endif
 
-        auto strType = dumpTypeToString(type).value();
-        execl("/usr/bin/dreport", "dreport", "-d", dumpPath.c_str(), "-i",
-              id.c_str(), "-s", std::to_string(size).c_str(), "-q", "-v", "-p",
-              path.empty() ? "" : path.c_str(), "-t", strType.c_str(), nullptr);
+    auto resources = getDumpResources(type);
+    auto command = dreportCommand(resources, std::move(args));
 
-        // dreport script execution is failed.
-        auto error = errno;
-        lg2::error("Error occurred during dreport function execution, "
-                   "errno: {ERRNO}",
-                   "ERRNO", error);
-        elog<InternalFailure>();
+    // The I/O priority is inherited by the child, it is set on the manager
+    // only for the duration of the launch.
+    int savedIoPriority = -1;
+    if (resources.ioClass)
+    {
+        savedIoPriority = setIoPriority(IOPRIO_PRIO_VALUE(
+            *resources.ioClass, resources.ioPriority.value_or(4)));
     }
-    else if (pid > 0)
+
+    // The type is persisted with the entry once the dump is complete
+    pendingTypes[dumpId] = strType;
+
+    pid_t pid = spawnDreport(command);
+    auto error = errno;
+
+    if (savedIoPriority >= 0)
     {
-        Child::Callback callback = [this, type, pid](Child&, const siginfo_t*) {
-            if (type == DumpTypes::USER)
+        setIoPriority(savedIoPriority);
+    }
+
+    if (pid > 0)
+    {
+        Child::Callback callback = [this, pid, strType, dumpPath,
+                                    dumpId](Child&, const siginfo_t* info) {
+            if ((info->si_code != CLD_EXITED) || (info->si_status != 0))
+            {
+                pendingTypes.erase(dumpId);
+                failJob(dumpId);
+            }
+            else if (userDumpId == dumpId)
             {
-                lg2::info("User initiated dump completed, resetting flag");
-                Manager::fUserDumpInProgress = false;
+                userDumpId.reset();
             }
-            this->childPtrMap.erase(pid);
+            releaseSpace(dumpId);
+            pluginStats.update(strType, dumpPath);
+
+            // Erasing the child destroys this callback
+            auto manager = this;
+            manager->childPtrMap.erase(pid);
+            manager->startJobs();
         };
         try
         {
@@ -158,15 +479,23 @@ uint32_t Manager::captureDump(DumpTypes type, const std::string& path)
                 "ERROR", ex);
             elog<InternalFailure>();
         }
+
+        // The space dreport may use is held until its dump is added, so the
+        // dreport instances running together stay within the total size
+        reservedUsage[dumpId] = static_cast<uint64_t>(size) * 1024;
+        usage += reservedUsage[dumpId];
     }
     else
     {
-        auto error = errno;
-        lg2::error("Error occurred during fork, errno: {ERRNO}", "ERRNO",
-                   error);
+        lg2::error("Error occurred during dreport execution, errno: {ERRNO}",
+                   "ERRNO", error);
+        pendingTypes.erase(dumpId);
+#ifdef BMC_DUMP_NATIVE_COLLECTOR
+        std::error_code ec;
+        std::filesystem::remove_all(nativeDir, ec);
+#endif
         elog<InternalFailure>();
     }
-    return ++lastEntryId;
 }
 
 phosphor::dump::Entry* Manager::createEntry(const std::filesystem::path& file)
@@ -205,7 +534,7 @@ phosphor::dump::Entry* Manager::createEntry(const std::filesystem::path& file)
     {
         auto entry =
             dynamic_cast<phosphor::dump::bmc::Entry*>(dumpEntry->second.get());
-        entry->update(timestamp, std::filesystem::file_size(file), file);
+        entry->update(timestamp, store::size(file), file);
         return entry;
     }
 
@@ -218,9 +547,27 @@ phosphor::dump::Entry* Manager::createEntry(const std::filesystem::path& file)
     {
         auto entry = std::make_unique<bmc::Entry>(
             bus, objPath.c_str(), id, timestamp,
-            std::filesystem::file_size(file), file,
+            store::size(file), file,
             phosphor::dump::OperationStatus::Completed, std::string(),
-            originatorTypes::Internal, *this);
+            originatorTypes::Internal, *this, offloadScheduler);
+
+        auto type = pendingTypes.find(id);
+        if (type != pendingTypes.end())
+        {
+            entry->setDumpType(type->second);
+            pendingTypes.erase(type);
+        }
+
+        // Dumps restored with their serialized data get the persisted
+        // digest on deserialization, only hash a dump seen for the first
+        // time.
+        const std::filesystem::path serializedFilePath =
+            file.parent_path() / ".preserve" / "serialized_entry.bin";
+        if (!std::filesystem::exists(serializedFilePath))
+        {
+            entry->updateDigest();
+            entry->serialize(serializedFilePath);
+        }
 
         auto entryPtr = entry.get();
         entries.insert(std::make_pair(id, std::move(entry)));
@@ -233,8 +580,7 @@ phosphor::dump::Entry* Manager::createEntry(const std::filesystem::path& file)
             "OBJECTPATH: {OBJECT_PATH}, ID: {ID}, TIMESTAMP: {TIMESTAMP}, "
             "SIZE: {SIZE}, FILENAME: {FILENAME}",
             "ERROR", e, "OBJECT_PATH", objPath, "ID", id, "TIMESTAMP",
-            timestamp, "SIZE", std::filesystem::file_size(file), "FILENAME",
-            file);
+            timestamp, "SIZE", store::size(file), "FILENAME", file);
         return nullptr;
     }
 }
@@ -244,17 +590,28 @@ void Manager::watchCallback(const UserMap& fileInfo)
     for (const auto& i : fileInfo)
     {
         // For any new dump file create dump entry object
-        // and associated inotify watch.
-        if (IN_CLOSE_WRITE == i.second)
+        // and associated inotify watch. dreport writes the dump to a hidden
+        // partial file and renames it once complete, so only the rename is
+        // watched and the writes to the archive do not wake the manager.
+        if (IN_MOVED_TO == i.second)
         {
             if (!std::filesystem::is_directory(i.first))
             {
+                if (i.first.filename().string().starts_with('.'))
+                {
+                    continue;
+                }
+
                 // Don't require filename to be passed, as the path
                 // of dump directory is stored in the childWatchMap
                 removeWatch(i.first.parent_path());
 
                 // dump file is written now create D-Bus entry
-                createEntry(i.first);
+                auto entry = createEntry(i.first);
+                if (entry != nullptr)
+                {
+                    addDump(*entry, i.first);
+                }
             }
             else
             {
@@ -262,11 +619,14 @@ void Manager::watchCallback(const UserMap& fileInfo)
             }
         }
         // Start inotify watch on newly created directory.
+        // The hidden directories, the trash and the frame store, are not
+        // dumps
         else if ((IN_CREATE == i.second) &&
-                 std::filesystem::is_directory(i.first))
+                 std::filesystem::is_directory(i.first) &&
+                 !i.first.filename().string().starts_with('.'))
         {
             auto watchObj = std::make_unique<Watch>(
-                eventLoop, IN_NONBLOCK, IN_CLOSE_WRITE, EPOLLIN, i.first,
+                eventLoop, IN_NONBLOCK, IN_MOVED_TO, EPOLLIN, i.first,
                 std::bind(
                     std::mem_fn(&phosphor::dump::bmc::Manager::watchCallback),
                     this, std::placeholders::_1));
@@ -282,6 +642,25 @@ void Manager::removeWatch(const std::filesystem::path& path)
     childWatchMap.erase(path);
 }
 
+/** @brief Size in bytes of the files of a dump directory. The frames of a
+ *         deduplicated dump are hard links to the frame store, they are
+ *         counted with the store.
+ */
+static uint64_t getDirectorySize(const std::filesystem::path& dir)
+{
+    std::error_code ec;
+    uint64_t size = 0;
+    for (const auto& p :
+         std::filesystem::recursive_directory_iterator(dir, ec))
+    {
+        if (p.is_regular_file(ec) && (p.hard_link_count(ec) == 1))
+        {
+            size += p.file_size(ec);
+        }
+    }
+    return size;
+}
+
 void Manager::restore()
 {
     std::filesystem::path dir(dumpDir);
@@ -301,15 +680,23 @@ void Manager::restore()
         {
             lastEntryId = std::max(lastEntryId,
                                    static_cast<uint32_t>(std::stoul(idStr)));
-            // Create dump entry d-bus object.
+            // Deduplicated archives are listed by their manifest
+            auto files = store::archives(p.path());
             for (const auto& fileIt :
                  std::filesystem::directory_iterator(p.path()))
             {
-                if (fileIt.path().filename() == ".preserve")
+                // Skip the serialized data and partial dump files
+                if (fileIt.path().filename().string().starts_with('.'))
                 {
                     continue;
                 }
-                auto entry = createEntry(fileIt.path());
+                files.push_back(fileIt.path());
+            }
+
+            // Create dump entry d-bus object.
+            for (const auto& file : files)
+            {
+                auto entry = createEntry(file);
 
                 if (entry != nullptr)
                 {
@@ -322,50 +709,321 @@ void Manager::restore()
                         // serialized file
                         entry->deserialize(serializedFilePath);
                     }
+                    // The manager may have stopped before the archive was
+                    // stored
+                    addDump(*entry, file);
                 }
             }
         }
     }
+
+    // Release the frames of the dumps deleted while the manager was stopped,
+    // then rebuild the usage ledger, with the dumps left in the trash.
+    store::collect(dir / storeDir);
+    usage = store::usage(dir / storeDir);
+    for (const auto& [id, size] : dumpUsage)
+    {
+        usage += size;
+    }
+    std::error_code ec;
+    for (const auto& p :
+         std::filesystem::directory_iterator(reaper.path(), ec))
+    {
+        auto size = getDirectorySize(p.path());
+        trashUsage[p.path().filename()] = {size, 0};
+        usage += size;
+        reclaimable += size;
+    }
+
+    // The dumps which expired while the manager was stopped are deleted
+    // from the expiry timer
+    armExpiryTimer();
 }
 
-size_t getDirectorySize(const std::string dir)
+void Manager::erase(uint32_t entryId)
 {
-    auto size = 0;
-    for (const auto& p : std::filesystem::recursive_directory_iterator(dir))
+    phosphor::dump::Manager::erase(entryId);
+    retention.remove(entryId);
+    storeCancel(entryId);
+
+    uint64_t size = 0;
+    auto dumpSize = dumpUsage.find(entryId);
+    if (dumpSize != dumpUsage.end())
     {
-        if (!std::filesystem::is_directory(p))
+        size = dumpSize->second;
+        dumpUsage.erase(dumpSize);
+    }
+
+    // The frames the dump shared with a single other dump are now only used
+    // by that dump, which frees them when it is deleted
+    auto frames = frameOwners.exclusive(entryId);
+    for (auto id : frameOwners.remove(entryId))
+    {
+        auto entry = entries.find(id);
+        if (entry != entries.end())
         {
-            size += std::ceil(std::filesystem::file_size(p) / 1024.0);
+            updateRetention(*entry->second);
         }
     }
-    return size;
+
+    // Removing the files of a large dump takes long on flash, they are
+    // removed in the background and their space is released once they are.
+    auto dir = std::filesystem::path(dumpDir) / std::to_string(entryId);
+    try
+    {
+        trashUsage[reaper.move(dir)] = {size, frames};
+        reclaimable += size + frames;
+        return;
+    }
+    catch (const std::filesystem::filesystem_error& e)
+    {
+        lg2::error("Failed to move the dump to the trash, errormsg: {ERROR}",
+                   "ERROR", e);
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    usage -= std::min(usage, size);
+
+    // Release the frames no other dump uses
+    auto freed = store::collect(std::filesystem::path(dumpDir) / storeDir);
+    usage -= std::min(usage, freed);
 }
 
-size_t Manager::getAllowedSize()
+void Manager::reaped(const std::string& name)
 {
-    // Get current size of the dump directory.
-    auto size = getDirectorySize(dumpDir);
+    auto size = trashUsage.find(name);
+    if (size != trashUsage.end())
+    {
+        // The frames are released from the usage by the collection
+        usage -= std::min(usage, size->second.files);
+        reclaimable -= std::min(reclaimable,
+                                size->second.files + size->second.frames);
+        trashUsage.erase(size);
+    }
 
-    // Set the Dump size to Maximum  if the free space is greater than
-    // Dump max size otherwise return the available size.
+    // Release the frames no other dump uses
+    auto freed = store::collect(std::filesystem::path(dumpDir) / storeDir);
+    usage -= std::min(usage, freed);
 
-    size = (size > BMC_DUMP_TOTAL_SIZE ? 0 : BMC_DUMP_TOTAL_SIZE - size);
+    // Start the jobs which were waiting for this space
+    startJobs();
+}
 
+void Manager::addDump(phosphor::dump::Entry& entry,
+                      const std::filesystem::path& file)
+{
+#ifdef BMC_DUMP_DEDUP
+    // The frames are moved to the store in the background, the archive is
+    // accounted as a file of the dump until then.
+    storeQueue.emplace_back(entry.getDumpId(), file);
+    storeNext();
+#endif
+
+    // The space reserved for dreport is replaced by the size of the dump
+    releaseSpace(entry.getDumpId());
+    accountDump(entry, file.parent_path());
+}
+
+void Manager::releaseSpace(uint32_t id)
+{
+    auto size = reservedUsage.find(id);
+    if (size != reservedUsage.end())
+    {
+        usage -= std::min(usage, size->second);
+        reservedUsage.erase(size);
+    }
+}
+
+void Manager::accountDump(phosphor::dump::Entry& entry,
+                          const std::filesystem::path& dir)
+{
+    // An existing entry is updated with a new archive
+    auto id = entry.getDumpId();
+    auto& size = dumpUsage[id];
+    usage -= std::min(usage, size);
+    size = getDirectorySize(dir);
+    usage += size;
+
+    // The frames of a deduplicated dump may have been used by a single
+    // other dump so far
+    for (auto other : frameOwners.add(id, dir))
+    {
+        auto otherEntry = entries.find(other);
+        if (otherEntry != entries.end())
+        {
+            updateRetention(*otherEntry->second);
+        }
+    }
+
+    updateRetention(entry);
+}
+
+void Manager::storeNext()
+{
+    if (storeAdder || storeQueue.empty())
+    {
+        return;
+    }
+    storeAdder = std::make_unique<store::Adder>(
+        std::filesystem::path(dumpDir) / storeDir, storeQueue.front().second);
+    storeSource = std::make_unique<sdeventplus::source::Defer>(
+        sdeventplus::Event::get_default(),
+        [this](auto& /*source*/) { storeStep(); });
+    storeSource->set_priority(SD_EVENT_PRIORITY_IDLE);
+    storeSource->set_enabled(sdeventplus::source::Enabled::On);
+}
+
+void Manager::storeStep()
+{
+    if (!storeAdder->step())
+    {
+        return;
+    }
+
+    auto [id, file] = storeQueue.front();
+    usage += storeAdder->newSize();
+    storeQueue.pop_front();
+    storeSource.reset();
+    storeAdder.reset();
+
+    // The frames linked by the dump are now counted with the store
+    auto entry = entries.find(id);
+    if (entry != entries.end())
+    {
+        accountDump(*entry->second, file.parent_path());
+    }
+    storeNext();
+}
+
+void Manager::storeCancel(uint32_t id)
+{
+    if (storeAdder && (storeQueue.front().first == id))
+    {
+        // The frames already stored are released with the dump
+        usage += storeAdder->newSize();
+        storeSource.reset();
+        storeAdder.reset();
+    }
+    std::erase_if(storeQueue,
+                  [id](const auto& archive) { return archive.first == id; });
+    storeNext();
+}
+
+void Manager::entryUpdated(uint32_t entryId)
+{
+    auto entry = entries.find(entryId);
+    if (entry != entries.end())
+    {
+        updateRetention(*entry->second);
+    }
+}
+
+void Manager::updateRetention(phosphor::dump::Entry& entry)
+{
+    auto bmcEntry = dynamic_cast<phosphor::dump::bmc::Entry*>(&entry);
+    if (bmcEntry == nullptr)
+    {
+        return;
+    }
+    auto id = bmcEntry->getDumpId();
+    retention.set(id, {bmcEntry->getDumpType(), bmcEntry->elapsed(),
+                       dumpUsage[id] + frameOwners.exclusive(id),
+                       bmcEntry->offloaded()});
+    armExpiryTimer();
+}
+
+void Manager::expireDumps()
+{
+    // Delete the dumps past the age limit of their type
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    for (auto id : retention.expired(now))
+    {
+        lg2::info("Deleting the expired dump {ID}", "ID", id);
+        entries.at(id)->delete_();
+    }
+    armExpiryTimer();
+}
+
+void Manager::armExpiryTimer()
+{
 #ifdef BMC_DUMP_ROTATE_CONFIG
-    // Delete the first existing file until the space is enough
+    auto next = retention.nextExpiry();
+    if (!next)
+    {
+        expiryTimer.setEnabled(false);
+        return;
+    }
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    auto delay = std::chrono::microseconds(
+        *next > static_cast<uint64_t>(now) ? *next - now : 0);
+    expiryTimer.restartOnce(
+        std::chrono::duration_cast<JobTimer::Duration>(delay));
+#endif
+}
+
+/** @brief Space in kilobytes left in the dump directory
+ *  @param[in] usage - Bytes used by the dumps.
+ */
+static size_t getAvailableSize(uint64_t usage)
+{
+    size_t size = std::ceil(usage / 1024.0);
+    return (size > BMC_DUMP_TOTAL_SIZE ? 0 : BMC_DUMP_TOTAL_SIZE - size);
+}
+
+bool Manager::spaceReady() const
+{
+    // Without deleted dumps to wait for, the start fails with QuotaExceeded
+    return (getAvailableSize(usage) >= BMC_DUMP_MIN_SPACE_REQD) ||
+           reaper.empty();
+}
+
+void Manager::makeSpace()
+{
+    // The space of the deleted dumps is released by the reaper in the
+    // background, it is counted as free here.
+    auto size = getAvailableSize(usage - std::min(usage, reclaimable));
+
+#ifdef BMC_DUMP_ROTATE_CONFIG
+    // Delete the dumps in the order of the retention policy until the space
+    // is enough. A deleted dump moves to the trash and its space counts as
+    // reclaimable at once: its files and the frames no other dump uses. The
+    // frames it shared with a single other dump count for that dump from
+    // then on.
     while (size < BMC_DUMP_MIN_SPACE_REQD)
     {
-        auto delEntry = min_element(
-            entries.begin(), entries.end(),
-            [](const auto& l, const auto& r) { return l.first < r.first; });
-        auto delPath = std::filesystem::path(dumpDir) /
-                       std::to_string(delEntry->first);
+        auto victim = retention.victim();
+        if (!victim)
+        {
+            break;
+        }
+        entries.at(*victim)->delete_();
+        size = getAvailableSize(usage - std::min(usage, reclaimable));
+    }
+#endif
 
-        size += getDirectorySize(delPath);
+    using namespace sdbusplus::xyz::openbmc_project::Dump::Create::Error;
+    using Reason = xyz::openbmc_project::Dump::Create::QuotaExceeded::REASON;
 
-        delEntry->second->delete_();
+    if (size < BMC_DUMP_MIN_SPACE_REQD)
+    {
+        // Reached to maximum limit
+        elog<QuotaExceeded>(Reason("Not enough space: Delete old dumps"));
     }
-#else
+}
+
+size_t Manager::getAllowedSize()
+{
+    // Get the free space of the dump directory from the usage ledger, the
+    // space reserved for the running dreport instances is not free.
+    // Set the Dump size to Maximum  if the free space is greater than
+    // Dump max size otherwise return the available size.
+    auto size = getAvailableSize(usage);
+
     using namespace sdbusplus::xyz::openbmc_project::Dump::Create::Error;
     using Reason = xyz::openbmc_project::Dump::Create::QuotaExceeded::REASON;
 
@@ -374,7 +1032,6 @@ size_t Manager::getAllowedSize()
         // Reached to maximum limit
         elog<QuotaExceeded>(Reason("Not enough space: Delete old dumps"));
     }
-#endif
 
     if (size > BMC_DUMP_MAX_SIZE)
     {
@@ -1,15 +1,31 @@
 #pragma once
 
+#include "dump_cache.hpp"
 #include "dump_entry.hpp"
+#include "dump_job_queue.hpp"
 #include "dump_manager.hpp"
+#include "dump_offload.hpp"
+#include "dump_retention.hpp"
+#include "dump_stats.hpp"
+#include "dump_store.hpp"
+#include "dump_trash.hpp"
 #include "dump_utils.hpp"
 #include "watch.hpp"
 
 #include <sdeventplus/source/child.hpp>
+#include <sdeventplus/source/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
 #include <xyz/openbmc_project/Dump/Create/server.hpp>
+#include <xyz/openbmc_project/Dump/ElogRateLimit/server.hpp>
 
+#include <chrono>
+#include <deque>
 #include <filesystem>
 #include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace phosphor
 {
@@ -19,7 +35,8 @@ namespace bmc
 {
 
 using CreateIface = sdbusplus::server::object_t<
-    sdbusplus::xyz::openbmc_project::Dump::server::Create>;
+    sdbusplus::xyz::openbmc_project::Dump::server::Create,
+    sdbusplus::xyz::openbmc_project::Dump::server::ElogRateLimit>;
 
 using UserMap = phosphor::dump::inotify::UserMap;
 
@@ -29,7 +46,8 @@ using ::sdeventplus::source::Child;
 /** @class Manager
  *  @brief OpenBMC Dump  manager implementation.
  *  @details A concrete implementation for the
- *  xyz.openbmc_project.Dump.Create DBus API
+ *  xyz.openbmc_project.Dump.Create DBus API, which also publishes the
+ *  counters of the error log dumps suppressed by the rate limits.
  */
 class Manager :
     virtual public CreateIface,
@@ -41,7 +59,12 @@ class Manager :
     Manager& operator=(const Manager&) = delete;
     Manager(Manager&&) = delete;
     Manager& operator=(Manager&&) = delete;
-    virtual ~Manager() = default;
+
+    virtual ~Manager()
+    {
+        // The entries may hold offload sessions queued on offloadScheduler
+        entries.clear();
+    }
 
     /** @brief Constructor to put object onto bus at a dbus path.
      *  @param[in] bus - Bus to attach to.
@@ -56,11 +79,20 @@ class Manager :
         phosphor::dump::Manager(bus, path, baseEntryPath),
         eventLoop(event.get()),
         dumpWatch(
-            eventLoop, IN_NONBLOCK, IN_CLOSE_WRITE | IN_CREATE, EPOLLIN,
-            filePath,
+            eventLoop, IN_NONBLOCK, IN_CREATE, EPOLLIN, filePath,
             std::bind(std::mem_fn(&phosphor::dump::bmc::Manager::watchCallback),
                       this, std::placeholders::_1)),
-        dumpDir(filePath)
+        dumpDir(filePath), offloadScheduler(BMC_DUMP_MAX_OFFLOADS),
+        pluginStats(BMC_DUMP_PLUGIN_STATS_PATH),
+        cacheInvalidator(bus, BMC_DUMP_CACHE_PATH),
+        retention(phosphor::dump::retention::load(BMC_DUMP_RETENTION_CONFIG)),
+        reaper(sdeventplus::Event::get_default(),
+               std::filesystem::path(filePath) / phosphor::dump::trash::trashDir,
+               std::bind_front(&Manager::reaped, this)),
+        jobTimer(sdeventplus::Event::get_default(),
+                 [this](JobTimer&) { startJobs(); }),
+        expiryTimer(sdeventplus::Event::get_default(),
+                    [this](JobTimer&) { expireDumps(); })
     {}
 
     /** @brief Implementation of dump watch call back
@@ -81,19 +113,107 @@ class Manager :
     sdbusplus::message::object_path
         createDump(phosphor::dump::DumpCreateParams params) override;
 
+    /** @brief Update the retention of an entry once it was offloaded
+     *  @param[in] entryId - unique identifier of the entry
+     */
+    void entryUpdated(uint32_t entryId) override;
+
+    /** @brief Whether an error log dump of the error type is waiting for
+     *  more errors, a request of the type is then collected in that dump.
+     *  @param[in] errorType - error type of the request
+     */
+    bool coalescing(const std::string& errorType) const;
+
+    /** @brief Count an error log dump suppressed by the rate limits
+     *  @param[in] errorType - error type of the dump
+     */
+    void dumpSuppressed(const std::string& errorType);
+
   private:
+    /** @brief Erase specified entry d-bus object and move the dump to the
+     *         trash, its space is released once it is removed.
+     *  @param[in] entryId - unique identifier of the entry
+     */
+    void erase(uint32_t entryId) override;
+
+    /** @brief Release the space of a dump removed from the trash
+     *  @param[in] name - Name of the dump in the trash.
+     */
+    void reaped(const std::string& name);
+
+    /** @brief Add or update the retention attributes of an entry
+     *  @param[in] entry - Dump entry.
+     */
+    void updateRetention(phosphor::dump::Entry& entry);
+
+    /** @brief Delete the dumps past the age limit of their type, from the
+     *         expiry timer.
+     */
+    void expireDumps();
+
+    /** @brief Arm the expiry timer for the next dump to expire, with the
+     *         rotate config.
+     */
+    void armExpiryTimer();
+
     /** @brief Create Dump entry d-bus object
      *  @param[in] fullPath - Full path of the Dump file name
      */
     phosphor::dump::Entry* createEntry(const std::filesystem::path& fullPath);
 
+    /** @brief Store a new dump archive, and account for the space of its
+     *         dump in the usage ledger.
+     *  @param[in] entry - Dump entry of the archive.
+     *  @param[in] file - Path of the archive.
+     */
+    void addDump(phosphor::dump::Entry& entry,
+                 const std::filesystem::path& file);
+
+    /** @brief Account for the space of a dump in the usage ledger and
+     *         update its retention attributes.
+     *  @param[in] entry - Dump entry.
+     *  @param[in] dir - Directory of the dump.
+     */
+    void accountDump(phosphor::dump::Entry& entry,
+                     const std::filesystem::path& dir);
+
+    /** @brief Release the space reserved for the dreport of a dump
+     *  @param[in] id - Id of the dump.
+     */
+    void releaseSpace(uint32_t id);
+
+    /** @brief Start moving the next queued archive to the frame store */
+    void storeNext();
+
+    /** @brief Run a step of the archive being moved to the frame store, from
+     *         the idle event source.
+     */
+    void storeStep();
+
+    /** @brief Stop moving the archives of a dump to the frame store
+     *  @param[in] id - Id of the dump.
+     */
+    void storeCancel(uint32_t id);
+
     /** @brief Capture BMC Dump based on the Dump type.
+     *  @param[in] id - The Dump entry id number.
      *  @param[in] type - Type of the dump to pass to dreport
-     *  @param[in] path - An absolute path to the file
-     *             to be included as part of Dump package.
-     *  @return id - The Dump entry id number.
+     *  @param[in] paths - Absolute paths to the files to be included as
+     *             part of Dump package, the first one is the main path.
+     */
+    void captureDump(uint32_t id, DumpTypes type,
+                     const std::vector<std::string>& paths);
+
+    /** @brief Start the queued jobs, highest priority class first, while
+     *         fewer than BMC_DUMP_MAX_JOBS dreport instances run.
+     */
+    void startJobs();
+
+    /** @brief Fail the entry of a job dreport did not complete, the entry
+     *  is shared by the requests folded into the job
+     *  @param[in] id - id of the dump entry
      */
-    uint32_t captureDump(DumpTypes type, const std::string& path);
+    void failJob(uint32_t id);
 
     /** @brief Remove specified watch object pointer from the
      *        watch map and associated entry from the map.
@@ -101,9 +221,25 @@ class Manager :
      */
     void removeWatch(const std::filesystem::path& path);
 
+    /** @brief Make sure a new dump fits, counting the space of the deleted
+     *         dumps not removed yet as free. With the rotate config, the
+     *         dumps selected by the retention policy are deleted until it
+     *         does.
+     *  @throws QuotaExceeded if there is not enough space.
+     */
+    void makeSpace();
+
+    /** @brief Whether a dump can start now
+     *  @returns false while the space it needs is held by deleted dumps the
+     *           reaper has not removed yet, the jobs are started again from
+     *           reaped().
+     */
+    bool spaceReady() const;
+
     /** @brief Calculate per dump allowed size based on the available
      *        size in the dump location.
      *  @returns dump size in kilobytes.
+     *  @throws QuotaExceeded if there is not enough space.
      */
     size_t getAllowedSize();
 
@@ -116,9 +252,95 @@ class Manager :
     /** @brief Path to the dump file*/
     std::string dumpDir;
 
-    /** @brief Flag to reject user intiated dump if a dump is in progress*/
-    // TODO: https://github.com/openbmc/phosphor-debug-collector/issues/19
-    static bool fUserDumpInProgress;
+    /** @brief Scheduler for the offload of the dump entries */
+    phosphor::dump::offload::Scheduler offloadScheduler;
+
+    /** @brief Rolling summary of the dreport plugin statistics */
+    phosphor::dump::stats::Summary pluginStats;
+
+    /** @brief Bytes used by each dump in the dump directory, by dump id.
+     *  @details The frames a deduplicated dump links to are counted with
+     *  the store only, the frames only the dump uses are known from
+     *  frameOwners.
+     */
+    std::map<uint32_t, uint64_t> dumpUsage;
+
+    /** @brief Bytes used by the dumps and the frame store, kept up to date as
+     *         the dumps are added and deleted instead of walking the dump
+     *         directory for each new dump. The space reserved for the
+     *         running dreport instances is counted too.
+     */
+    uint64_t usage = 0;
+
+    /** @brief Bytes reserved for the running dreport instances, by dump id,
+     *  the size limit each was given. A reservation is replaced by the size
+     *  of the dump once it is added, or released when dreport exits.
+     */
+    std::map<uint32_t, uint64_t> reservedUsage;
+
+    /** @brief Invalidates the dreport collection cache on D-Bus changes */
+    phosphor::dump::cache::Invalidator cacheInvalidator;
+
+    /** @brief Selects the dumps to evict with the rotate config */
+    phosphor::dump::retention::Engine retention;
+
+    /** @brief Types of the dumps being collected, by dump id */
+    std::map<uint32_t, std::string> pendingTypes;
+
+    /** @struct Trashed
+     *  @brief Space of a deleted dump not removed yet
+     */
+    struct Trashed
+    {
+        /** @brief Bytes of the files of the dump, released by the reaper */
+        uint64_t files;
+
+        /** @brief Bytes of the stored frames no other dump uses, released
+         *  by the collection of the store once the dump is removed */
+        uint64_t frames;
+    };
+
+    /** @brief Space of the deleted dumps not removed yet, by name in the
+     *  trash. It is counted in the usage until they are removed.
+     */
+    std::map<std::string, Trashed> trashUsage;
+
+    /** @brief Bytes of trashUsage, released once the reaper removed them */
+    uint64_t reclaimable = 0;
+
+    /** @brief Dumps using each stored frame, to count the frames a dump
+     *  frees when it is deleted */
+    phosphor::dump::store::Owners frameOwners;
+
+    /** @brief Removes the deleted dumps in the background */
+    phosphor::dump::trash::Reaper reaper;
+
+    /** @brief Archives waiting to be moved to the frame store, with the id
+     *  of their dump, the first one is being moved */
+    std::deque<std::pair<uint32_t, std::filesystem::path>> storeQueue;
+
+    /** @brief Moves the first archive of storeQueue to the frame store */
+    std::unique_ptr<phosphor::dump::store::Adder> storeAdder;
+
+    /** @brief Idle event source running the steps of storeAdder */
+    std::unique_ptr<sdeventplus::source::Defer> storeSource;
+
+    /** @brief Dump requests waiting for dreport to be started */
+    JobQueue jobs{std::chrono::seconds(BMC_DUMP_COALESCE_WINDOW)};
+
+    /** @brief Id of the user dump queued or being collected, another user
+     *  dump is rejected until it completes when BMC_DUMP_SINGLE_USER is set
+     */
+    std::optional<uint32_t> userDumpId;
+
+    using JobTimer =
+        sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>;
+
+    /** @brief Starts the jobs at the end of their coalescing window */
+    JobTimer jobTimer;
+
+    /** @brief Deletes the dumps once they are past their age limit */
+    JobTimer expiryTimer;
 
     /** @brief Child directory path and its associated watch object map
      *        [path:watch object]
@@ -12,6 +12,7 @@
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
 
+#include <csignal>
 #include <memory>
 #include <vector>
 
@@ -57,6 +58,14 @@ int main()
         return EXIT_FAILURE;
     }
 
+    // A dump consumer closing its socket mid-offload must fail the offload
+    // with EPIPE instead of terminating the manager.
+    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+    {
+        lg2::error("Unable to ignore SIGPIPE, errno: {ERRNO}", "ERRNO", errno);
+        return EXIT_FAILURE;
+    }
+
     // Add sdbusplus ObjectManager for the 'root' path of the DUMP manager.
     sdbusplus::server::manager_t objManager(bus, DUMP_OBJPATH);
 
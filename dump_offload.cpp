@@ -2,7 +2,13 @@
 
 #include "dump_offload.hpp"
 
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -14,7 +20,9 @@
 #include <xyz/openbmc_project/Common/File/error.hpp>
 #include <xyz/openbmc_project/Common/error.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <system_error>
 
 namespace phosphor
 {
@@ -26,59 +34,131 @@ namespace offload
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
 using namespace phosphor::logging;
 
-/** @brief API to write data on unix socket.
+/** @brief Maximum number of bytes handed to a single sendfile() call */
+constexpr auto offloadChunkSize = 128 * 1024;
+
+/** @brief Time allowed for the consumer to connect to the socket */
+constexpr auto acceptTimeout = std::chrono::seconds(1);
+
+/** @brief Time allowed for the socket to become writable again */
+constexpr auto writeTimeout = std::chrono::seconds(5);
+
+/** @brief Time allowed for a range reader to make room in its pipe */
+constexpr auto rangeTimeout = std::chrono::seconds(30);
+
+/** @brief Minimum time between two progress reports of a session */
+constexpr auto progressInterval = std::chrono::seconds(1);
+
+/** @brief Open the archive of a dump for reading
+ *
+ *  @param[out] reader - reader of the archive.
+ *  @param[in] file - dump filename with relative path.
+ *  @param[in] dumpId - id of the dump.
+ *
+ *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Open
+ *  if the archive can not be opened.
+ */
+static void openArchive(std::optional<store::Reader>& reader,
+                        const std::filesystem::path& file, uint32_t dumpId)
+{
+    using namespace sdbusplus::xyz::openbmc_project::Common::File::Error;
+    using ErrnoOpen = xyz::openbmc_project::Common::File::Open::ERRNO;
+    using PathOpen = xyz::openbmc_project::Common::File::Open::PATH;
+
+    int err = EIO;
+    try
+    {
+        reader.emplace(file);
+        return;
+    }
+    catch (const std::system_error& e)
+    {
+        err = e.code().value();
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to read the dump manifest, errormsg: {ERROR}, "
+                   "DUMP_ID: {DUMP_ID}",
+                   "ERROR", e, "DUMP_ID", dumpId);
+    }
+    lg2::error("Failed to open the dump from file, errno: {ERRNO}, "
+               "DUMPFILE: {DUMP_FILE}, DUMP_ID: {DUMP_ID}",
+               "ERRNO", err, "DUMP_FILE", file, "DUMP_ID", dumpId);
+    elog<Open>(ErrnoOpen(err), PathOpen(file.c_str()));
+}
+
+/** @brief API to wait until the unix socket is ready for writing.
  *
  * @param[in] socket     - unix socket
- * @param[in] buf        - buffer
- * @param[in] blockSize  - size of data
  *
  * @return  void
  */
-void writeOnUnixSocket(const int socket, const char* buf,
-                       const uint64_t blockSize)
+void waitForWritable(const int socket)
 {
-    int numOfBytesWrote = 0;
+    fd_set writeFileDescriptor;
+    struct timeval timeVal;
+    timeVal.tv_sec = 5;
+    timeVal.tv_usec = 0;
 
-    for (uint64_t i = 0; i < blockSize; i = i + numOfBytesWrote)
+    FD_ZERO(&writeFileDescriptor);
+    FD_SET(socket, &writeFileDescriptor);
+    int nextFileDescriptor = socket + 1;
+
+    int retVal = select(nextFileDescriptor, NULL, &writeFileDescriptor, NULL,
+                        &timeVal);
+    if (retVal <= 0)
     {
-        numOfBytesWrote = 0;
-        fd_set writeFileDescriptor;
-        struct timeval timeVal;
-        timeVal.tv_sec = 5;
-        timeVal.tv_usec = 0;
+        lg2::error("waitForWritable: select() failed, errno: {ERRNO}", "ERRNO",
+                   errno);
+        std::string msg = "select() failed " + std::string(strerror(errno));
+        throw std::runtime_error(msg);
+    }
+}
+
+/** @brief API to send a file on unix socket.
+ *
+ *  The data is moved from the page cache to the socket with sendfile(),
+ *  in chunks of at most offloadChunkSize bytes, so the dump is never
+ *  copied into a user space buffer.
+ *
+ * @param[in] socket     - unix socket
+ * @param[in] fd         - file descriptor of the dump file
+ * @param[in] size       - number of bytes to send
+ *
+ * @return  void
+ */
+void sendFileOnUnixSocket(const int socket, const int fd, const uint64_t size)
+{
+    off_t offset = 0;
 
-        FD_ZERO(&writeFileDescriptor);
-        FD_SET(socket, &writeFileDescriptor);
-        int nextFileDescriptor = socket + 1;
+    while (static_cast<uint64_t>(offset) < size)
+    {
+        waitForWritable(socket);
 
-        int retVal = select(nextFileDescriptor, NULL, &writeFileDescriptor,
-                            NULL, &timeVal);
-        if (retVal <= 0)
+        auto count = std::min<uint64_t>(size - offset, offloadChunkSize);
+        auto numOfBytesSent = sendfile(socket, fd, &offset, count);
+        if (numOfBytesSent < 0)
         {
-            lg2::error("writeOnUnixSocket: select() failed, errno: {ERRNO}",
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                continue;
+            }
+            lg2::error("sendFileOnUnixSocket: sendfile() failed, "
+                       "errno: {ERRNO}",
                        "ERRNO", errno);
-            std::string msg = "select() failed " + std::string(strerror(errno));
+            std::string msg = "sendfile() on socket failed " +
+                              std::string(strerror(errno));
             throw std::runtime_error(msg);
         }
-        if ((retVal > 0) && (FD_ISSET(socket, &writeFileDescriptor)))
+        if (numOfBytesSent == 0)
         {
-            numOfBytesWrote = write(socket, buf + i, blockSize - i);
-            if (numOfBytesWrote < 0)
-            {
-                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-                {
-                    numOfBytesWrote = 0;
-                    continue;
-                }
-                lg2::error("writeOnUnixSocket: write() failed, errno: {ERRNO}",
-                           "ERRNO", errno);
-                std::string msg = "write() on socket failed " +
-                                  std::string(strerror(errno));
-                throw std::runtime_error(msg);
-            }
+            // The file got shorter than it was when the offload started
+            lg2::error("sendFileOnUnixSocket: unexpected end of file, "
+                       "OFFSET: {OFFSET}, SIZE: {SIZE}",
+                       "OFFSET", offset, "SIZE", size);
+            throw std::runtime_error("Unexpected end of dump file");
         }
     }
-    return;
 }
 
 /**@brief API to setup unix socket.
@@ -173,58 +253,462 @@ void requestOffload(std::filesystem::path file, uint32_t dumpId,
                 throw std::runtime_error(msg);
             }
 
-            std::ifstream infile{file, std::ios::in | std::ios::binary};
-            if (!infile.good())
+            CustomFd fileFD = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fileFD() < 0)
             {
                 // Unable to open the dump file
+                auto err = errno;
                 lg2::error("Failed to open the dump from file, errno: {ERRNO}, "
                            "DUMPFILE: {DUMP_FILE}, DUMP_ID: {DUMP_ID}",
-                           "ERRNO", errno, "DUMP_FILE", file, "DUMP_ID",
-                           dumpId);
-                elog<Open>(ErrnoOpen(errno), PathOpen(file.c_str()));
+                           "ERRNO", err, "DUMP_FILE", file, "DUMP_ID", dumpId);
+                elog<Open>(ErrnoOpen(err), PathOpen(file.c_str()));
             }
 
-            infile.exceptions(std::ifstream::failbit | std::ifstream::badbit |
-                              std::ifstream::eofbit);
+            struct stat fileStat;
+            if (fstat(fileFD(), &fileStat) < 0)
+            {
+                auto err = errno;
+                lg2::error("Failed to get the dump file size, errno: {ERRNO}, "
+                           "DUMPFILE: {DUMP_FILE}, DUMP_ID: {DUMP_ID}",
+                           "ERRNO", err, "DUMP_FILE", file, "DUMP_ID", dumpId);
+                elog<Open>(ErrnoOpen(err), PathOpen(file.c_str()));
+            }
 
             lg2::info("Opening File for RW, FILENAME: {FILENAME}", "FILENAME",
                       file.filename().c_str());
 
-            std::filebuf* pbuf = infile.rdbuf();
-
-            // get file size using buffer's members
-            std::size_t size = pbuf->pubseekoff(0, infile.end, infile.in);
-            pbuf->pubseekpos(0, infile.in);
-
-            // allocate memory to contain file data
-            std::unique_ptr<char[]> buffer(new char[size]);
-            // get file data
-            pbuf->sgetn(buffer.get(), size);
-            infile.close();
-
-            writeOnUnixSocket(socketFD(), buffer.get(), size);
+            sendFileOnUnixSocket(socketFD(), fileFD(), fileStat.st_size);
         }
     }
-    catch (const std::ifstream::failure& oe)
+    catch (const std::exception& e)
     {
         std::remove(writePath.c_str());
         auto err = errno;
-        lg2::error("Failed to open, errormsg: {ERROR}, "
-                   "OPENINTERFACE: {OPEN_INTERFACE}, DUMP_ID: {DUMP_ID}",
-                   "ERROR", oe, "OPEN_INTERFACE", file, "DUMP_ID", dumpId);
-        elog<Open>(ErrnoOpen(err), PathOpen(file.c_str()));
+        lg2::error("Failed to offload dump, errormsg: {ERROR}, "
+                   "DUMPFILE: {DUMP_FILE}, DUMP_ID: {DUMP_ID}",
+                   "ERROR", e, "DUMP_FILE", writePath, "DUMP_ID", dumpId);
+        elog<Write>(ErrnoWrite(err), PathWrite(writePath.c_str()));
+    }
+    std::remove(writePath.c_str());
+    return;
+}
+
+Session::Session(const sdeventplus::Event& event,
+                 const std::filesystem::path& file, uint32_t dumpId,
+                 const std::string& writePath, uint64_t startOffset,
+                 Scheduler& scheduler, Callback callback) :
+    event(event), dumpId(dumpId), writePath(writePath), scheduler(scheduler),
+    callback(std::move(callback)),
+    timer(event, [this](Timer&) { timeoutCallback(); })
+{
+    using namespace sdbusplus::xyz::openbmc_project::Common::File::Error;
+    using ErrnoWrite = xyz::openbmc_project::Common::File::Write::ERRNO;
+    using PathWrite = xyz::openbmc_project::Common::File::Write::PATH;
+
+    openArchive(reader, file, dumpId);
+    size = reader->size();
+
+    if (startOffset > size)
+    {
+        lg2::error("Offload offset beyond the end of the dump, "
+                   "OFFSET: {OFFSET}, SIZE: {SIZE}, DUMP_ID: {DUMP_ID}",
+                   "OFFSET", startOffset, "SIZE", size, "DUMP_ID", dumpId);
+        reader.reset();
+        elog<InvalidArgument>(
+            xyz::openbmc_project::Common::InvalidArgument::ARGUMENT_NAME(
+                "OFFSET"),
+            xyz::openbmc_project::Common::InvalidArgument::ARGUMENT_VALUE(
+                std::to_string(startOffset).c_str()));
+    }
+    this->startOffset = startOffset;
+    offset = startOffset;
+    acknowledged = startOffset;
+    reader->seek(startOffset);
+
+    try
+    {
+        listenFD.emplace(socketInit(writePath));
+        listenSource.emplace(
+            event, (*listenFD)(), EPOLLIN,
+            std::bind_front(&Session::acceptCallback, this));
     }
     catch (const std::exception& e)
     {
-        std::remove(writePath.c_str());
         auto err = errno;
         lg2::error("Failed to offload dump, errormsg: {ERROR}, "
                    "DUMPFILE: {DUMP_FILE}, DUMP_ID: {DUMP_ID}",
                    "ERROR", e, "DUMP_FILE", writePath, "DUMP_ID", dumpId);
+        release();
         elog<Write>(ErrnoWrite(err), PathWrite(writePath.c_str()));
     }
+
+    // The consumer may connect while the session is queued, it is only
+    // accepted once the scheduler starts the session.
+    listenSource->set_enabled(sdeventplus::source::Enabled::Off);
+    this->callback(State::Queued, progress(0));
+    scheduler.add(*this);
+}
+
+Session::~Session()
+{
+    if (active)
+    {
+        lg2::info("Offload aborted, DUMP_ID: {DUMP_ID}", "DUMP_ID", dumpId);
+        release();
+    }
+}
+
+void Session::start()
+{
+    lg2::info("Starting offload, DUMP_ID: {DUMP_ID}, OFFSET: {OFFSET}",
+              "DUMP_ID", dumpId, "OFFSET", offset);
+    lastReport = {std::chrono::steady_clock::now(), offset};
+    listenSource->set_enabled(sdeventplus::source::Enabled::On);
+    timer.restartOnce(acceptTimeout);
+    callback(State::InProgress, progress(0));
+}
+
+void Session::acceptCallback(sdeventplus::source::IO& /*source*/, int fd,
+                             uint32_t /*revents*/)
+{
+    int clientFD = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientFD < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return;
+        }
+        lg2::error("accept() failed, errno: {ERRNO}, DUMP_ID: {DUMP_ID}",
+                   "ERRNO", errno, "DUMP_ID", dumpId);
+        finish(false);
+        return;
+    }
+    socketFD.emplace(clientFD);
+
+    // Only one consumer is served per offload
+    listenSource->set_enabled(sdeventplus::source::Enabled::Off);
+
+    if (static_cast<uint64_t>(offset) == size)
+    {
+        finish(true);
+        return;
+    }
+
+    lg2::info("Offloading dump, DUMP_ID: {DUMP_ID}, OFFSET: {OFFSET}, "
+              "SIZE: {SIZE}",
+              "DUMP_ID", dumpId, "OFFSET", offset, "SIZE", size);
+
+    writeSource.emplace(event, clientFD, EPOLLOUT,
+                        std::bind_front(&Session::writeCallback, this));
+    timer.restartOnce(writeTimeout);
+}
+
+void Session::writeCallback(sdeventplus::source::IO& /*source*/, int fd,
+                            uint32_t revents)
+{
+    if (revents & (EPOLLERR | EPOLLHUP))
+    {
+        lg2::error("Offload consumer disconnected, DUMP_ID: {DUMP_ID}, "
+                   "OFFSET: {OFFSET}",
+                   "DUMP_ID", dumpId, "OFFSET", offset);
+        finish(false);
+        return;
+    }
+
+    updateAcknowledged();
+
+    auto count = std::min<uint64_t>(size - offset, offloadChunkSize);
+    auto numOfBytesSent =
+        reader->transfer(count, [fd](int in, off_t* inOffset, size_t chunk) {
+            return sendfile(fd, in, inOffset, chunk);
+        });
+    if (numOfBytesSent > 0)
+    {
+        offset += numOfBytesSent;
+    }
+    if (numOfBytesSent < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return;
+        }
+        lg2::error("sendfile() on socket failed, errno: {ERRNO}, "
+                   "DUMP_ID: {DUMP_ID}",
+                   "ERRNO", errno, "DUMP_ID", dumpId);
+        finish(false);
+        return;
+    }
+    if (numOfBytesSent == 0)
+    {
+        lg2::error("Unexpected end of dump file, DUMP_ID: {DUMP_ID}, "
+                   "OFFSET: {OFFSET}, SIZE: {SIZE}",
+                   "DUMP_ID", dumpId, "OFFSET", offset, "SIZE", size);
+        finish(false);
+        return;
+    }
+
+    if (static_cast<uint64_t>(offset) == size)
+    {
+        lg2::info("Offload completed, DUMP_ID: {DUMP_ID}", "DUMP_ID", dumpId);
+        finish(true);
+        return;
+    }
+
+    reportProgress();
+    timer.restartOnce(writeTimeout);
+}
+
+void Session::reportProgress()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        now - lastReport.first);
+    if (elapsed < progressInterval)
+    {
+        return;
+    }
+
+    uint64_t rate = (offset - lastReport.second) * 1000000 / elapsed.count();
+    lastReport = {now, offset};
+    callback(State::InProgress, progress(rate));
+}
+
+void Session::updateAcknowledged()
+{
+    if (!socketFD)
+    {
+        return;
+    }
+
+    // Data the consumer had not read when it went away is discarded along
+    // with the socket, only trust the queue length of a live connection.
+    char byte;
+    if (recv((*socketFD)(), &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT) ==
+        0)
+    {
+        return;
+    }
+
+    int unread = 0;
+    if (ioctl((*socketFD)(), SIOCOUTQ, &unread) < 0)
+    {
+        return;
+    }
+    acknowledged = std::max<off_t>(acknowledged, offset - unread);
+}
+
+Session::Progress Session::progress(uint64_t rate) const
+{
+    return {static_cast<uint64_t>(offset - startOffset), rate,
+            static_cast<uint64_t>(acknowledged)};
+}
+
+void Session::timeoutCallback()
+{
+    lg2::error("Offload timed out, DUMP_ID: {DUMP_ID}, OFFSET: {OFFSET}",
+               "DUMP_ID", dumpId, "OFFSET", offset);
+    finish(false);
+}
+
+void Session::release()
+{
+    active = false;
+    timer.setEnabled(false);
+
+    // Sources are only disabled here as this may run from their own
+    // callback, they are destroyed along with the session.
+    if (writeSource)
+    {
+        writeSource->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    if (listenSource)
+    {
+        listenSource->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    socketFD.reset();
+    listenFD.reset();
+    reader.reset();
     std::remove(writePath.c_str());
-    return;
+    scheduler.remove(*this);
+}
+
+void Session::finish(bool success)
+{
+    if (!active)
+    {
+        return;
+    }
+    if (success)
+    {
+        acknowledged = offset;
+    }
+    else
+    {
+        updateAcknowledged();
+    }
+    release();
+    callback(success ? State::Completed : State::Failed, progress(0));
+}
+
+void Scheduler::add(Session& session)
+{
+    pending.push_back(&session);
+    startNext();
+}
+
+void Scheduler::remove(Session& session)
+{
+    if (running.erase(&session) == 0)
+    {
+        std::erase(pending, &session);
+        return;
+    }
+    startNext();
+}
+
+void Scheduler::startNext()
+{
+    while ((running.size() < maxSessions) && !pending.empty())
+    {
+        auto session = pending.front();
+        pending.pop_front();
+        running.insert(session);
+        session->start();
+    }
+}
+
+RangeStream::RangeStream(const sdeventplus::Event& event,
+                         const std::filesystem::path& file, uint32_t dumpId,
+                         uint64_t offset, uint64_t length,
+                         Callback callback) :
+    dumpId(dumpId), callback(std::move(callback))
+{
+    using Argument = xyz::openbmc_project::Common::InvalidArgument;
+
+    openArchive(reader, file, dumpId);
+
+    uint64_t size = reader->size();
+    if (offset > size)
+    {
+        lg2::error("Range offset beyond the end of the dump, "
+                   "OFFSET: {OFFSET}, SIZE: {SIZE}, DUMP_ID: {DUMP_ID}",
+                   "OFFSET", offset, "SIZE", size, "DUMP_ID", dumpId);
+        elog<InvalidArgument>(
+            Argument::ARGUMENT_NAME("OFFSET"),
+            Argument::ARGUMENT_VALUE(std::to_string(offset).c_str()));
+    }
+    if ((length == 0) || (length > size - offset))
+    {
+        length = size - offset;
+    }
+    this->offset = offset;
+    end = offset + length;
+    reader->seek(offset);
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0)
+    {
+        lg2::error("Failed to create the range pipe, errno: {ERRNO}, "
+                   "DUMP_ID: {DUMP_ID}",
+                   "ERRNO", errno, "DUMP_ID", dumpId);
+        elog<InternalFailure>();
+    }
+    readFD = fds[0];
+    pipeFD.emplace(fds[1]);
+
+    // Only the write end is non-blocking, the reader decides for its end
+    if (fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK) < 0)
+    {
+        lg2::error("Failed to configure the range pipe, errno: {ERRNO}, "
+                   "DUMP_ID: {DUMP_ID}",
+                   "ERRNO", errno, "DUMP_ID", dumpId);
+        close(std::exchange(readFD, -1));
+        elog<InternalFailure>();
+    }
+
+    if (this->offset == end)
+    {
+        active = false;
+        pipeFD.reset();
+        reader.reset();
+        return;
+    }
+
+    writeSource.emplace(event, fds[1], EPOLLOUT,
+                        std::bind_front(&RangeStream::writeCallback, this));
+    timer.emplace(event, [this](Timer&) {
+        lg2::info("Range reader inactive, stopping the stream, "
+                  "DUMP_ID: {DUMP_ID}",
+                  "DUMP_ID", this->dumpId);
+        finish();
+    });
+    timer->restartOnce(rangeTimeout);
+}
+
+void RangeStream::writeCallback(sdeventplus::source::IO& /*source*/, int fd,
+                                uint32_t revents)
+{
+    if (revents & (EPOLLERR | EPOLLHUP))
+    {
+        // The reader closed the pipe before the end of the range
+        finish();
+        return;
+    }
+
+    auto count = std::min<uint64_t>(end - offset, offloadChunkSize);
+    auto numOfBytes =
+        reader->transfer(count, [fd](int in, off_t* inOffset, size_t chunk) {
+            return splice(in, inOffset, fd, nullptr, chunk,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        });
+    if (numOfBytes > 0)
+    {
+        offset += numOfBytes;
+    }
+    if (numOfBytes < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return;
+        }
+        lg2::error("splice() to range pipe failed, errno: {ERRNO}, "
+                   "DUMP_ID: {DUMP_ID}",
+                   "ERRNO", errno, "DUMP_ID", dumpId);
+        finish();
+        return;
+    }
+    if ((numOfBytes == 0) || (offset == end))
+    {
+        finish();
+        return;
+    }
+    timer->restartOnce(rangeTimeout);
+}
+
+void RangeStream::finish()
+{
+    if (!active)
+    {
+        return;
+    }
+    active = false;
+
+    // The sources are only disabled as this may run from their callbacks
+    if (writeSource)
+    {
+        writeSource->set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    if (timer)
+    {
+        timer->setEnabled(false);
+    }
+    pipeFD.reset();
+    reader.reset();
+
+    if (callback)
+    {
+        callback(*this);
+    }
 }
 
 } // namespace offload
@@ -1,6 +1,21 @@
 #pragma once
 
+#include "dump_store.hpp"
+#include "dump_utils.hpp"
+
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <optional>
+#include <set>
+#include <utility>
 
 namespace phosphor
 {
@@ -21,6 +36,345 @@ namespace offload
 void requestOffload(std::filesystem::path file, uint32_t dumpId,
                     std::string writePath);
 
+class Scheduler;
+
+/** @class Session
+ *  @brief Offload of one dump file driven by the sd-event loop.
+ *  @details The UNIX socket is created when the session is constructed, so
+ *  the consumer can connect right away, and the session is queued on the
+ *  offload scheduler. Once the scheduler starts it, accepting the consumer
+ *  and sending the dump are handled by sd-event IO sources. At most one
+ *  chunk is sent with sendfile() each time the socket becomes writable, so
+ *  running sessions and the other event sources are served in turn. The
+ *  caller is not blocked while the offload runs and the progress and the
+ *  outcome are reported through the status callback.
+ */
+class Session
+{
+  public:
+    /** @brief States of an offload session */
+    enum class State
+    {
+        Queued,
+        InProgress,
+        Completed,
+        Failed
+    };
+
+    /** @struct Progress
+     *  @brief Progress of an offload session
+     */
+    struct Progress
+    {
+        /** @brief Number of bytes sent by this session */
+        uint64_t bytesSent;
+
+        /** @brief Transfer rate in bytes per second */
+        uint64_t rate;
+
+        /** @brief Offset up to which the consumer is known to have read
+         *         the dump. A new session can resume from there.
+         */
+        uint64_t acknowledged;
+    };
+
+    /** @brief Status callback, invoked on every state change and at most
+     *         once per progressInterval while the dump is being sent.
+     *  @param[in] state - state of the session
+     *  @param[in] progress - progress of the session
+     */
+    using Callback = std::function<void(State state, const Progress& progress)>;
+
+    Session() = delete;
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    Session(Session&&) = delete;
+    Session& operator=(Session&&) = delete;
+
+    /** @brief Create the socket and start waiting for the consumer
+     *
+     *  @param[in] event - sd-event loop to attach to.
+     *  @param[in] file - dump filename with relative path.
+     *  @param[in] dumpId - id of the dump.
+     *  @param[in] writePath - path of the UNIX socket to write the dump to.
+     *  @param[in] startOffset - offset of the first byte of the dump to send.
+     *  @param[in] scheduler - offload scheduler to queue the session on.
+     *  @param[in] callback - status callback, must not destroy the session.
+     *
+     *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Open
+     *  if the dump file can not be opened.
+     *  @throws sdbusplus::xyz::openbmc_project::Common::Error::InvalidArgument
+     *  if startOffset is beyond the end of the dump.
+     *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Write
+     *  if the socket can not be created.
+     */
+    Session(const sdeventplus::Event& event, const std::filesystem::path& file,
+            uint32_t dumpId, const std::string& writePath, uint64_t startOffset,
+            Scheduler& scheduler, Callback callback);
+
+    /** @brief Abort the offload if it is still running */
+    ~Session();
+
+    /** @brief Check whether the offload is queued or running
+     *  @return true until the offload completed or failed
+     */
+    bool isActive() const
+    {
+        return active;
+    }
+
+    /** @brief Start accepting the consumer, called by the scheduler */
+    void start();
+
+  private:
+    /** @brief Listening socket readable, accept the consumer */
+    void acceptCallback(sdeventplus::source::IO& source, int fd,
+                        uint32_t revents);
+
+    /** @brief Consumer socket writable, send the next chunk */
+    void writeCallback(sdeventplus::source::IO& source, int fd,
+                       uint32_t revents);
+
+    /** @brief Consumer did not connect or stopped reading in time */
+    void timeoutCallback();
+
+    /** @brief Release the sockets and report the result
+     *  @param[in] success - true if the whole dump was sent
+     */
+    void finish(bool success);
+
+    /** @brief Report the progress if progressInterval has elapsed */
+    void reportProgress();
+
+    /** @brief Update the acknowledged offset from the amount of data the
+     *         consumer has not read yet from the socket.
+     */
+    void updateAcknowledged();
+
+    /** @brief Current progress of the session
+     *  @param[in] rate - transfer rate in bytes per second
+     */
+    Progress progress(uint64_t rate) const;
+
+    /** @brief Timer type used for the accept and write timeouts */
+    using Timer = sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>;
+
+    /** @brief Release the sockets and the dump file */
+    void release();
+
+    /** @brief sd-event loop the session is attached to */
+    sdeventplus::Event event;
+
+    /** @brief Id of the dump being offloaded */
+    uint32_t dumpId;
+
+    /** @brief Path of the UNIX socket */
+    std::string writePath;
+
+    /** @brief Scheduler the session is queued on */
+    Scheduler& scheduler;
+
+    /** @brief Status callback */
+    Callback callback;
+
+    /** @brief Dump archive */
+    std::optional<store::Reader> reader;
+
+    /** @brief Size of the dump file in bytes */
+    uint64_t size = 0;
+
+    /** @brief Offset of the first byte sent by this session */
+    off_t startOffset = 0;
+
+    /** @brief Offset of the next byte to send */
+    off_t offset = 0;
+
+    /** @brief Offset up to which the consumer has read the dump */
+    off_t acknowledged = 0;
+
+    /** @brief Listening UNIX socket */
+    std::optional<CustomFd> listenFD;
+
+    /** @brief Accepted consumer socket */
+    std::optional<CustomFd> socketFD;
+
+    /** @brief Event source for the listening socket */
+    std::optional<sdeventplus::source::IO> listenSource;
+
+    /** @brief Event source for the consumer socket */
+    std::optional<sdeventplus::source::IO> writeSource;
+
+    /** @brief Accept and write inactivity timer */
+    Timer timer;
+
+    /** @brief Time and offset of the last progress report */
+    std::pair<std::chrono::steady_clock::time_point, off_t> lastReport;
+
+    /** @brief Whether the offload is queued or running */
+    bool active = true;
+};
+
+/** @class Scheduler
+ *  @brief Bounded scheduler for the offload sessions.
+ *  @details Runs at most maxSessions sessions at the same time, the other
+ *  sessions wait in first come first served order until a running session
+ *  completes, fails or is destroyed.
+ */
+class Scheduler
+{
+  public:
+    Scheduler() = delete;
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler(Scheduler&&) = delete;
+    Scheduler& operator=(Scheduler&&) = delete;
+    ~Scheduler() = default;
+
+    /** @brief Constructor
+     *  @param[in] maxSessions - maximum number of sessions run in parallel
+     */
+    explicit Scheduler(size_t maxSessions) :
+        maxSessions(std::max<size_t>(maxSessions, 1))
+    {}
+
+    /** @brief Queue a session, it is started right away if a slot is free
+     *  @param[in] session - session to be queued
+     */
+    void add(Session& session);
+
+    /** @brief Remove a queued or running session and start the next one
+     *  @param[in] session - session to be removed
+     */
+    void remove(Session& session);
+
+  private:
+    /** @brief Start queued sessions while slots are free */
+    void startNext();
+
+    /** @brief Maximum number of sessions run in parallel */
+    size_t maxSessions;
+
+    /** @brief Running sessions */
+    std::set<Session*> running;
+
+    /** @brief Sessions waiting for a free slot */
+    std::deque<Session*> pending;
+};
+
+/** @class RangeStream
+ *  @brief Stream of a range of a dump file into a pipe.
+ *  @details Each stream has its own file descriptor to the dump and its own
+ *  pipe, so any number of ranges of the same dump can be read at the same
+ *  time. The range is moved into the pipe with splice() from an sd-event IO
+ *  source whenever the pipe has room, the write end of the pipe is closed
+ *  after the last byte of the range so the reader sees end of file. The
+ *  stream stops early if the reader closes the read end or stops reading
+ *  for rangeTimeout, and the done callback lets the owner release it.
+ */
+class RangeStream
+{
+  public:
+    RangeStream() = delete;
+    RangeStream(const RangeStream&) = delete;
+    RangeStream& operator=(const RangeStream&) = delete;
+    RangeStream(RangeStream&&) = delete;
+    RangeStream& operator=(RangeStream&&) = delete;
+
+    /** @brief Done callback, invoked once when the stream finishes.
+     *  @param[in] stream - the finished stream, must not be destroyed from
+     *                      the callback.
+     */
+    using Callback = std::function<void(RangeStream& stream)>;
+
+    /** @brief Close the read end of the pipe if it was not released */
+    ~RangeStream()
+    {
+        if (readFD >= 0)
+        {
+            close(readFD);
+        }
+    }
+
+    /** @brief Open the dump and create the pipe
+     *
+     *  @param[in] event - sd-event loop to attach to.
+     *  @param[in] file - dump filename with relative path.
+     *  @param[in] dumpId - id of the dump.
+     *  @param[in] offset - offset of the first byte of the range.
+     *  @param[in] length - number of bytes in the range, 0 for up to the end
+     *                      of the dump.
+     *  @param[in] callback - done callback, not invoked for an empty range.
+     *
+     *  @throws sdbusplus::xyz::openbmc_project::Common::File::Error::Open
+     *  if the dump file can not be opened.
+     *  @throws sdbusplus::xyz::openbmc_project::Common::Error::InvalidArgument
+     *  if the range is not within the dump.
+     *  @throws sdbusplus::xyz::openbmc_project::Common::Error::InternalFailure
+     *  if the pipe can not be created.
+     */
+    RangeStream(const sdeventplus::Event& event,
+                const std::filesystem::path& file, uint32_t dumpId,
+                uint64_t offset, uint64_t length, Callback callback);
+
+    /** @brief Hand over the read end of the pipe
+     *  @return The read end, owned by the caller from now on.
+     */
+    int releaseReadFD()
+    {
+        return std::exchange(readFD, -1);
+    }
+
+    /** @brief Check whether the range is still being written
+     *  @return true until the whole range was written or the reader left
+     */
+    bool isActive() const
+    {
+        return active;
+    }
+
+  private:
+    /** @brief Pipe writable, move the next chunk of the range into it */
+    void writeCallback(sdeventplus::source::IO& source, int fd,
+                       uint32_t revents);
+
+    /** @brief Close the dump and the write end of the pipe and invoke the
+     *  done callback */
+    void finish();
+
+    /** @brief Timer type used for the inactivity timeout */
+    using Timer = sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>;
+
+    /** @brief Id of the dump being read */
+    uint32_t dumpId;
+
+    /** @brief Done callback */
+    Callback callback;
+
+    /** @brief Dump archive */
+    std::optional<store::Reader> reader;
+
+    /** @brief Write end of the pipe */
+    std::optional<CustomFd> pipeFD;
+
+    /** @brief Read end of the pipe until it is released */
+    int readFD = -1;
+
+    /** @brief Offset of the next byte to write */
+    off_t offset = 0;
+
+    /** @brief Offset after the last byte of the range */
+    off_t end = 0;
+
+    /** @brief Event source for the write end of the pipe */
+    std::optional<sdeventplus::source::IO> writeSource;
+
+    /** @brief Reader inactivity timer */
+    std::optional<Timer> timer;
+
+    /** @brief Whether the range is still being written */
+    bool active = true;
+};
+
 } // namespace offload
 } // namespace dump
 } // namespace phosphor
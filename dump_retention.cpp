@@ -0,0 +1,206 @@
+#include "dump_retention.hpp"
+
+#include <nlohmann/json.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <fstream>
+#include <limits>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace retention
+{
+
+/** @brief Read the policy of a dump type, the fields not set are left as
+ *  they are.
+ */
+static void readTypePolicy(const nlohmann::json& json, TypePolicy& policy)
+{
+    policy.rank = json.value("rank", policy.rank);
+    policy.evict = json.value("evict", policy.evict);
+    policy.quota = json.value("quota", policy.quota / 1024) * 1024;
+    policy.maxAge = std::chrono::seconds(
+        json.value("maxAge", policy.maxAge.count()));
+}
+
+Policy load(const std::filesystem::path& file)
+{
+    Policy policy;
+    std::ifstream in(file);
+    if (!in.is_open())
+    {
+        return policy;
+    }
+
+    try
+    {
+        auto json = nlohmann::json::parse(in);
+        auto order = json.value("order", std::string("oldest"));
+        if (order == "largest")
+        {
+            policy.order = Order::Largest;
+        }
+        else if (order != "oldest")
+        {
+            lg2::error("Invalid dump retention order {ORDER}, the oldest "
+                       "dumps are evicted first",
+                       "ORDER", order);
+        }
+        policy.keepNotOffloaded = json.value("keepNotOffloaded", false);
+        if (json.contains("default"))
+        {
+            readTypePolicy(json.at("default"), policy.defaults);
+        }
+        if (json.contains("types"))
+        {
+            for (const auto& [type, value] : json.at("types").items())
+            {
+                auto& typePolicy = policy.types[type];
+                typePolicy = policy.defaults;
+                readTypePolicy(value, typePolicy);
+            }
+        }
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        lg2::error("Failed to load the dump retention policy {PATH}, "
+                   "error: {ERROR}",
+                   "PATH", file, "ERROR", e);
+        return Policy();
+    }
+    return policy;
+}
+
+Engine::Engine(Policy policy) : policy(std::move(policy)) {}
+
+const TypePolicy& Engine::typePolicy(const std::string& type) const
+{
+    auto it = policy.types.find(type);
+    return (it == policy.types.end()) ? policy.defaults : it->second;
+}
+
+bool Engine::evictable(const Dump& dump) const
+{
+    return typePolicy(dump.type).evict &&
+           (dump.offloaded || !policy.keepNotOffloaded);
+}
+
+Engine::Key Engine::key(uint32_t id, const Dump& dump) const
+{
+    // The dump ids grow with the creation order
+    uint64_t position = id;
+    if (policy.order == Order::Largest)
+    {
+        position = std::numeric_limits<uint64_t>::max() - dump.size;
+    }
+    return {typePolicy(dump.type).rank, position, id};
+}
+
+void Engine::set(uint32_t id, const Dump& dump)
+{
+    remove(id);
+
+    dumps.emplace(id, dump);
+    typeUsage[dump.type] += dump.size;
+    if (evictable(dump))
+    {
+        auto dumpKey = key(id, dump);
+        index.insert(dumpKey);
+        typeIndex[dump.type].insert(dumpKey);
+        ageIndex[dump.type].emplace(dump.timestamp, id);
+    }
+}
+
+void Engine::remove(uint32_t id)
+{
+    auto it = dumps.find(id);
+    if (it == dumps.end())
+    {
+        return;
+    }
+    const auto& dump = it->second;
+
+    auto& usage = typeUsage[dump.type];
+    usage -= std::min(usage, dump.size);
+    if (evictable(dump))
+    {
+        auto dumpKey = key(id, dump);
+        index.erase(dumpKey);
+        typeIndex[dump.type].erase(dumpKey);
+        ageIndex[dump.type].erase({dump.timestamp, id});
+    }
+    dumps.erase(it);
+}
+
+std::optional<uint32_t> Engine::victim() const
+{
+    for (const auto& [type, usage] : typeUsage)
+    {
+        auto quota = typePolicy(type).quota;
+        auto dumpsOfType = typeIndex.find(type);
+        if ((quota > 0) && (usage > quota) &&
+            (dumpsOfType != typeIndex.end()) && !dumpsOfType->second.empty())
+        {
+            return std::get<2>(*dumpsOfType->second.begin());
+        }
+    }
+    if (index.empty())
+    {
+        return std::nullopt;
+    }
+    return std::get<2>(*index.begin());
+}
+
+std::vector<uint32_t> Engine::expired(uint64_t now) const
+{
+    using namespace std::chrono;
+
+    std::vector<uint32_t> ids;
+    for (const auto& [type, dumpsOfType] : ageIndex)
+    {
+        auto maxAge = typePolicy(type).maxAge;
+        if (maxAge.count() <= 0)
+        {
+            continue;
+        }
+        auto ageLimit = duration_cast<microseconds>(maxAge).count();
+        for (const auto& [timestamp, id] : dumpsOfType)
+        {
+            if (timestamp + ageLimit >= now)
+            {
+                break;
+            }
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+std::optional<uint64_t> Engine::nextExpiry() const
+{
+    using namespace std::chrono;
+
+    std::optional<uint64_t> next;
+    for (const auto& [type, dumpsOfType] : ageIndex)
+    {
+        auto maxAge = typePolicy(type).maxAge;
+        if ((maxAge.count() <= 0) || dumpsOfType.empty())
+        {
+            continue;
+        }
+        // A dump expires once it is strictly older than the limit
+        auto expiry = dumpsOfType.begin()->first +
+                      duration_cast<microseconds>(maxAge).count() + 1;
+        if (!next || (expiry < *next))
+        {
+            next = expiry;
+        }
+    }
+    return next;
+}
+
+} // namespace retention
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace retention
+{
+
+/** @brief Order the dumps of a rank are evicted in */
+enum class Order
+{
+    Oldest,
+    Largest
+};
+
+/** @struct TypePolicy
+ *  @brief Retention of the dumps of a type
+ */
+struct TypePolicy
+{
+    /** @brief The dumps of the lower ranks are evicted first */
+    int rank = 0;
+
+    /** @brief Whether the dumps of the type can be evicted */
+    bool evict = true;
+
+    /** @brief Bytes the dumps of the type use before they are evicted ahead
+     *  of the other types, 0 for no quota */
+    uint64_t quota = 0;
+
+    /** @brief Age the dumps of the type are evicted at, 0 for no limit */
+    std::chrono::seconds maxAge{0};
+};
+
+/** @struct Policy
+ *  @brief Retention policy of the dumps
+ */
+struct Policy
+{
+    /** @brief Order the dumps of a rank are evicted in */
+    Order order = Order::Oldest;
+
+    /** @brief Whether the dumps not offloaded yet are kept */
+    bool keepNotOffloaded = false;
+
+    /** @brief Policy of the types not listed */
+    TypePolicy defaults;
+
+    /** @brief Policy by dump type name */
+    std::map<std::string, TypePolicy> types;
+};
+
+/** @brief Load the retention policy from a JSON file.
+ *  @details The default policy, the oldest dump first, is returned if the
+ *  file does not exist or is invalid:
+ *  {
+ *      "order": "oldest" | "largest",
+ *      "keepNotOffloaded": false,
+ *      "default": { "rank": 0, "evict": true, "quota": 0, "maxAge": 0 },
+ *      "types": { "<dump type>": { "rank": 0, ... } }
+ *  }
+ *  quota is in kilobytes and maxAge in seconds.
+ *
+ *  @param[in] file - Path of the policy.
+ *  @return The retention policy.
+ */
+Policy load(const std::filesystem::path& file);
+
+/** @struct Dump
+ *  @brief Retention attributes of a dump
+ */
+struct Dump
+{
+    /** @brief Dump type name, empty if unknown */
+    std::string type;
+
+    /** @brief Creation time in microseconds since the epoch */
+    uint64_t timestamp;
+
+    /** @brief Bytes the dump uses */
+    uint64_t size;
+
+    /** @brief Whether the dump was offloaded */
+    bool offloaded;
+};
+
+/** @class Engine
+ *  @brief Selects the dumps to evict.
+ *  @details The dumps which can be evicted are kept in ordered indexes, by
+ *  rank then by the eviction order, globally and by type, and by creation
+ *  time for the age limits: selecting a victim is O(number of types), adding
+ *  and removing a dump O(log n).
+ */
+class Engine
+{
+  public:
+    Engine() = delete;
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+    Engine(Engine&&) = delete;
+    Engine& operator=(Engine&&) = delete;
+    ~Engine() = default;
+
+    /** @brief Constructor
+     *  @param[in] policy - Retention policy.
+     */
+    explicit Engine(Policy policy);
+
+    /** @brief Add a dump or update its attributes
+     *  @param[in] id - Dump id.
+     *  @param[in] dump - Retention attributes of the dump.
+     */
+    void set(uint32_t id, const Dump& dump);
+
+    /** @brief Remove a dump
+     *  @param[in] id - Dump id.
+     */
+    void remove(uint32_t id);
+
+    /** @brief Next dump to evict to make space
+     *  @details The oldest or largest dump of a type over its quota, else
+     *  of the lowest rank.
+     *  @return Dump id, std::nullopt if no dump can be evicted.
+     */
+    std::optional<uint32_t> victim() const;
+
+    /** @brief Dumps past the age limit of their type
+     *  @param[in] now - Current time in microseconds since the epoch.
+     *  @return Dump ids.
+     */
+    std::vector<uint32_t> expired(uint64_t now) const;
+
+    /** @brief Time the next dump goes past the age limit of its type
+     *  @return Time in microseconds since the epoch, std::nullopt if no
+     *  dump has an age limit.
+     */
+    std::optional<uint64_t> nextExpiry() const;
+
+  private:
+    /** @brief Eviction key: rank, position in the eviction order, dump id */
+    using Key = std::tuple<int, uint64_t, uint32_t>;
+
+    /** @brief Policy of a dump type */
+    const TypePolicy& typePolicy(const std::string& type) const;
+
+    /** @brief Whether the policy allows to evict a dump */
+    bool evictable(const Dump& dump) const;
+
+    /** @brief Eviction key of a dump */
+    Key key(uint32_t id, const Dump& dump) const;
+
+    /** @brief Retention policy */
+    Policy policy;
+
+    /** @brief Retention attributes, by dump id */
+    std::map<uint32_t, Dump> dumps;
+
+    /** @brief Bytes used by the dumps, by type */
+    std::map<std::string, uint64_t> typeUsage;
+
+    /** @brief Dumps which can be evicted, in eviction order */
+    std::set<Key> index;
+
+    /** @brief Dumps which can be evicted, in eviction order, by type */
+    std::map<std::string, std::set<Key>> typeIndex;
+
+    /** @brief Dumps which can be evicted, by type and creation time */
+    std::map<std::string, std::set<std::pair<uint64_t, uint32_t>>> ageIndex;
+};
+
+} // namespace retention
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,157 @@
+#include "dump_stats.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <fstream>
+#include <numeric>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace stats
+{
+
+/** @brief Number of recent runs the average wall time is computed over */
+constexpr size_t recentRuns = 16;
+
+/** @brief Minimum number of runs before the slow runs are logged */
+constexpr size_t minRuns = 3;
+
+/** @brief A run is slow when it takes this many times the average */
+constexpr uint64_t slowFactor = 2;
+
+/** @brief Runs shorter than this are not logged as slow, in ms */
+constexpr uint64_t slowThreshold = 1000;
+
+Summary::Summary(const std::filesystem::path& file) : file(file)
+{
+    std::ifstream in(file);
+    if (!in.is_open())
+    {
+        return;
+    }
+    try
+    {
+        summary = nlohmann::json::parse(in);
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        lg2::error("Failed to parse the plugin statistics {PATH}, "
+                   "error: {ERROR}",
+                   "PATH", file, "ERROR", e);
+    }
+    if (!summary.is_object())
+    {
+        summary = nlohmann::json::object();
+    }
+}
+
+void Summary::update(const std::string& type, const std::filesystem::path& dir)
+{
+    auto statsFile = dir / pluginStatsFile;
+    nlohmann::json runs;
+    {
+        std::ifstream in(statsFile);
+        if (!in.is_open())
+        {
+            return;
+        }
+        try
+        {
+            runs = nlohmann::json::parse(in);
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            lg2::error("Failed to parse the plugin statistics {PATH}, "
+                       "error: {ERROR}",
+                       "PATH", statsFile, "ERROR", e);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove(statsFile, ec);
+    if (!runs.is_array())
+    {
+        return;
+    }
+
+    auto& plugins = summary[type];
+    if (!plugins.is_object())
+    {
+        plugins = nlohmann::json::object();
+    }
+    for (const auto& run : runs)
+    {
+        if (!run.is_object() || !run.contains("plugin") ||
+            !run["plugin"].is_string())
+        {
+            continue;
+        }
+        auto name = run["plugin"].get<std::string>();
+        auto wallTime = run.value("wall_ms", uint64_t{0});
+        auto& plugin = plugins[name];
+        if (!plugin.is_object())
+        {
+            plugin = nlohmann::json::object();
+        }
+
+        auto recent = plugin.value("recent_wall_ms", std::vector<uint64_t>{});
+        if (recent.size() >= minRuns)
+        {
+            auto average = std::accumulate(recent.begin(), recent.end(),
+                                           uint64_t{0}) /
+                           recent.size();
+            if ((wallTime > slowThreshold) &&
+                (wallTime > average * slowFactor))
+            {
+                lg2::warning("Dump plugin {PLUGIN} took {DURATION} ms, "
+                             "its recent average is {AVERAGE} ms",
+                             "PLUGIN", name, "DURATION", wallTime, "AVERAGE",
+                             average);
+            }
+        }
+        recent.push_back(wallTime);
+        if (recent.size() > recentRuns)
+        {
+            recent.erase(recent.begin());
+        }
+
+        plugin["runs"] = plugin.value("runs", uint64_t{0}) + 1;
+        plugin["max_wall_ms"] = std::max(plugin.value("max_wall_ms",
+                                                      uint64_t{0}),
+                                         wallTime);
+        plugin["recent_wall_ms"] = recent;
+        plugin["last"] = run;
+    }
+    save();
+}
+
+void Summary::save() const
+{
+    auto temp = file;
+    temp += ".tmp";
+    std::error_code ec;
+    std::filesystem::create_directories(file.parent_path(), ec);
+    {
+        std::ofstream out(temp);
+        out << summary.dump(2) << std::endl;
+        if (out.fail())
+        {
+            lg2::error("Failed to write the plugin statistics {PATH}", "PATH",
+                       temp);
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temp, file, ec);
+    if (ec)
+    {
+        lg2::error("Failed to save the plugin statistics {PATH}, "
+                   "error: {ERROR}",
+                   "PATH", file, "ERROR", ec.message());
+    }
+}
+
+} // namespace stats
+} // namespace dump
+} // namespace phosphor
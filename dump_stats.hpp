@@ -0,0 +1,62 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <string>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace stats
+{
+
+/** @brief Name of the file dreport leaves the plugin statistics of a dump
+ *  in, in the directory of the dump.
+ */
+constexpr auto pluginStatsFile = ".plugin_stats.json";
+
+/** @class Summary
+ *  @brief Rolling summary of the dreport plugin statistics.
+ *  @details For each dump type and plugin, the summary keeps the number of
+ *  runs, the statistics of the last run and the wall times of the recent
+ *  runs, persisted as JSON. A plugin run taking much longer than the recent
+ *  average is logged, to point at the plugin when dumps get slower.
+ */
+class Summary
+{
+  public:
+    Summary() = delete;
+    Summary(const Summary&) = delete;
+    Summary& operator=(const Summary&) = delete;
+    Summary(Summary&&) = delete;
+    Summary& operator=(Summary&&) = delete;
+    ~Summary() = default;
+
+    /** @brief Constructor to load the persisted summary.
+     *  @param[in] file - Path of the persisted summary.
+     */
+    explicit Summary(const std::filesystem::path& file);
+
+    /** @brief Add the plugin statistics of a dump to the summary.
+     *  @details The statistics file left by dreport is removed.
+     *  @param[in] type - Dump collection type.
+     *  @param[in] dir - Directory of the dump.
+     */
+    void update(const std::string& type, const std::filesystem::path& dir);
+
+  private:
+    /** @brief Persist the summary, replacing the file atomically */
+    void save() const;
+
+    /** @brief Path of the persisted summary */
+    std::filesystem::path file;
+
+    /** @brief Summary, by dump type and plugin name */
+    nlohmann::json summary = nlohmann::json::object();
+};
+
+} // namespace stats
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,621 @@
+#include "dump_store.hpp"
+
+#include "dump_digest.hpp"
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace store
+{
+
+/** @brief Directory of the links to the frames, in the dedup directory */
+constexpr auto framesDir = "frames";
+
+/** @brief Maximum number of bytes copied or hashed by a step of Adder */
+constexpr auto copyChunkSize = 128 * 1024;
+
+/** @brief Length of a hex encoded SHA-256 digest */
+constexpr size_t digestLength = 64;
+
+/** @brief Path of the manifest of a deduplicated archive */
+static std::filesystem::path manifestPath(const std::filesystem::path& archive)
+{
+    return archive.parent_path() / dedupDir / archive.filename();
+}
+
+/** @brief Path of the frame index dreport writes next to an archive */
+static std::filesystem::path
+    frameIndexPath(const std::filesystem::path& archive)
+{
+    return archive.parent_path() /
+           ("." + archive.filename().string() + frameIndexSuffix);
+}
+
+/** @brief Read the frames of a deduplicated archive from its manifest */
+static std::vector<Frame> readManifest(const std::filesystem::path& manifest)
+{
+    std::ifstream in(manifest);
+    if (!in.is_open())
+    {
+        throw std::runtime_error("Failed to open " + manifest.string());
+    }
+    std::vector<Frame> frames;
+    Frame frame;
+    while (in >> frame.digest >> frame.size)
+    {
+        frames.push_back(frame);
+    }
+    if (!in.eof())
+    {
+        throw std::runtime_error("Invalid manifest " + manifest.string());
+    }
+    return frames;
+}
+
+/** @brief Copy a range of a file to the current offset of another file */
+static void copyRange(int in, off_t offset, uint64_t size, int out)
+{
+    while (size > 0)
+    {
+        auto count = sendfile(out, in, &offset,
+                              std::min<uint64_t>(size, copyChunkSize));
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error(std::string("sendfile() failed, ") +
+                                     std::strerror(errno));
+        }
+        if (count == 0)
+        {
+            throw std::runtime_error("Unexpected end of file");
+        }
+        size -= count;
+    }
+}
+
+/** @brief Path of a frame in the store */
+static std::filesystem::path framePath(const std::filesystem::path& root,
+                                       const std::string& digest)
+{
+    return root / digest.substr(0, 2) / digest;
+}
+
+/** @brief Read the frames listed in the frame index of an archive, as size
+ *  and digest lines. The digest is empty if dreport did not write it. */
+static std::optional<std::vector<Frame>>
+    readFrameIndex(const std::filesystem::path& index)
+{
+    std::ifstream in(index);
+    if (!in.is_open())
+    {
+        return std::nullopt;
+    }
+    std::vector<Frame> frames;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        Frame frame{"", 0};
+        if (!(fields >> frame.size))
+        {
+            throw std::runtime_error("Invalid frame size");
+        }
+        if ((fields >> frame.digest) &&
+            ((frame.digest.size() != digestLength) ||
+             !std::ranges::all_of(frame.digest, [](char c) {
+                 return std::isxdigit(static_cast<unsigned char>(c)) &&
+                        !std::isupper(static_cast<unsigned char>(c));
+             })))
+        {
+            throw std::runtime_error("Invalid frame digest");
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+Adder::Adder(const std::filesystem::path& root,
+             const std::filesystem::path& archive) :
+    root(root), archive(archive), dir(archive.parent_path() / dedupDir)
+{
+    auto index = frameIndexPath(archive);
+    std::error_code ec;
+    try
+    {
+        auto list = readFrameIndex(index);
+        if (!list)
+        {
+            finished = true;
+            return;
+        }
+        frames = std::move(*list);
+
+        uint64_t total = 0;
+        for (const auto& frame : frames)
+        {
+            total += frame.size;
+        }
+        auto archiveSize = std::filesystem::file_size(archive, ec);
+        if (frames.empty() || ec || (total != archiveSize))
+        {
+            throw std::runtime_error("Frame sizes not matching the archive");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Invalid frame index {PATH}, the archive is not "
+                   "deduplicated, error: {ERROR}",
+                   "PATH", index, "ERROR", e);
+        std::filesystem::remove(index, ec);
+        finished = true;
+        return;
+    }
+
+    try
+    {
+        std::filesystem::create_directories(dir / framesDir);
+        std::filesystem::create_directories(root);
+        archiveFD.emplace(open(archive.c_str(), O_RDONLY | O_CLOEXEC));
+        if ((*archiveFD)() < 0)
+        {
+            throw std::runtime_error("Failed to open " + archive.string());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fail(e);
+    }
+}
+
+Adder::~Adder()
+{
+    if (tmpFD)
+    {
+        tmpFD.reset();
+        std::error_code ec;
+        std::filesystem::remove(root / ".frame.tmp", ec);
+    }
+}
+
+bool Adder::step()
+{
+    if (finished)
+    {
+        return true;
+    }
+
+    try
+    {
+        if (current == frames.size())
+        {
+            finish();
+            return true;
+        }
+
+        auto& frame = frames[current];
+        auto count = std::min<uint64_t>(frame.size - done, copyChunkSize);
+        if (frame.digest.empty())
+        {
+            // dreport did not hash the frame, it is read from the archive
+            if (!hasher)
+            {
+                hasher.emplace();
+                buffer.resize(copyChunkSize);
+            }
+            auto numOfBytes = pread((*archiveFD)(), buffer.data(), count,
+                                    offset + done);
+            if (numOfBytes < 0)
+            {
+                if (errno == EINTR)
+                {
+                    return false;
+                }
+                throw std::runtime_error(std::string("read() failed, ") +
+                                         std::strerror(errno));
+            }
+            if (numOfBytes == 0)
+            {
+                throw std::runtime_error("Unexpected end of file");
+            }
+            hasher->update(buffer.data(), numOfBytes);
+            done += numOfBytes;
+            if (done == frame.size)
+            {
+                frame.digest = hasher->final();
+                hasher.reset();
+                done = 0;
+            }
+            return false;
+        }
+
+        auto stored = framePath(root, frame.digest);
+        if (!tmpFD)
+        {
+            if (std::filesystem::exists(stored))
+            {
+                link(stored);
+                return false;
+            }
+            auto tmpFile = root / ".frame.tmp";
+            tmpFD.emplace(open(tmpFile.c_str(),
+                               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if ((*tmpFD)() < 0)
+            {
+                tmpFD.reset();
+                throw std::runtime_error("Failed to create " +
+                                         tmpFile.string());
+            }
+        }
+
+        // Only the frames new to the store are copied
+        copyRange((*archiveFD)(), offset + done, count, (*tmpFD)());
+        done += count;
+        if (done == frame.size)
+        {
+            tmpFD.reset();
+            std::filesystem::create_directories(stored.parent_path());
+            std::filesystem::rename(root / ".frame.tmp", stored);
+            newFrames.push_back(stored);
+            added += frame.size;
+            link(stored);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fail(e);
+        return true;
+    }
+    return false;
+}
+
+void Adder::link(const std::filesystem::path& frame)
+{
+    auto link = dir / framesDir / frame.filename();
+    if (!std::filesystem::exists(link))
+    {
+        std::filesystem::create_hard_link(frame, link);
+    }
+    offset += frames[current].size;
+    done = 0;
+    current++;
+}
+
+void Adder::finish()
+{
+    // The archive is removed only once its manifest is complete
+    auto tmpManifest = dir / ("." + archive.filename().string() + ".tmp");
+    std::ofstream out(tmpManifest);
+    for (const auto& frame : frames)
+    {
+        out << frame.digest << " " << frame.size << "\n";
+    }
+    out.close();
+    if (out.fail())
+    {
+        throw std::runtime_error("Failed to write " + tmpManifest.string());
+    }
+    std::filesystem::rename(tmpManifest, manifestPath(archive));
+
+    std::error_code ec;
+    archiveFD.reset();
+    std::filesystem::remove(archive, ec);
+    std::filesystem::remove(frameIndexPath(archive), ec);
+    lg2::info("Deduplicated {PATH}, {FRAMES} frames", "PATH", archive,
+              "FRAMES", frames.size());
+    finished = true;
+    stored = true;
+}
+
+void Adder::fail(const std::exception& e)
+{
+    lg2::error("Failed to deduplicate {PATH}, error: {ERROR}", "PATH",
+               archive, "ERROR", e);
+    std::error_code ec;
+    archiveFD.reset();
+    tmpFD.reset();
+    std::filesystem::remove(root / ".frame.tmp", ec);
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::remove(frameIndexPath(archive), ec);
+    for (const auto& frame : newFrames)
+    {
+        std::filesystem::remove(frame, ec);
+    }
+    newFrames.clear();
+    added = 0;
+    finished = true;
+}
+
+std::optional<uint64_t> add(const std::filesystem::path& root,
+                            const std::filesystem::path& archive)
+{
+    Adder adder(root, archive);
+    while (!adder.step())
+    {}
+    if (!adder.deduplicated())
+    {
+        return std::nullopt;
+    }
+    return adder.newSize();
+}
+
+std::vector<uint32_t> Owners::add(uint32_t id,
+                                  const std::filesystem::path& dir)
+{
+    auto changed = remove(id);
+    auto& owned = digests[id];
+    for (const auto& archive : archives(dir))
+    {
+        try
+        {
+            for (const auto& frame : readManifest(manifestPath(archive)))
+            {
+                owned.insert(frame.digest);
+                auto& owners = frames.try_emplace(frame.digest,
+                                                  Owned{frame.size, {}})
+                                   .first->second;
+                if (owners.ids.size() == 1)
+                {
+                    changed.push_back(*owners.ids.begin());
+                }
+                owners.ids.insert(id);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Failed to read the frames of {PATH}, error: {ERROR}",
+                       "PATH", archive, "ERROR", e);
+        }
+    }
+    if (owned.empty())
+    {
+        digests.erase(id);
+    }
+
+    std::erase(changed, id);
+    std::ranges::sort(changed);
+    changed.erase(std::ranges::unique(changed).begin(), changed.end());
+    return changed;
+}
+
+std::vector<uint32_t> Owners::remove(uint32_t id)
+{
+    std::vector<uint32_t> changed;
+    auto owned = digests.find(id);
+    if (owned == digests.end())
+    {
+        return changed;
+    }
+    for (const auto& digest : owned->second)
+    {
+        auto owners = frames.find(digest);
+        owners->second.ids.erase(id);
+        if (owners->second.ids.empty())
+        {
+            frames.erase(owners);
+        }
+        else if (owners->second.ids.size() == 1)
+        {
+            changed.push_back(*owners->second.ids.begin());
+        }
+    }
+    digests.erase(owned);
+
+    std::ranges::sort(changed);
+    changed.erase(std::ranges::unique(changed).begin(), changed.end());
+    return changed;
+}
+
+uint64_t Owners::exclusive(uint32_t id) const
+{
+    uint64_t size = 0;
+    auto owned = digests.find(id);
+    if (owned == digests.end())
+    {
+        return size;
+    }
+    for (const auto& digest : owned->second)
+    {
+        const auto& owners = frames.at(digest);
+        if (owners.ids.size() == 1)
+        {
+            size += owners.size;
+        }
+    }
+    return size;
+}
+
+uint64_t collect(const std::filesystem::path& root)
+{
+    std::error_code ec;
+    std::vector<std::filesystem::path> unused;
+    for (const auto& p :
+         std::filesystem::recursive_directory_iterator(root, ec))
+    {
+        if (p.is_regular_file(ec) && (p.hard_link_count(ec) == 1))
+        {
+            unused.push_back(p.path());
+        }
+    }
+
+    uint64_t freed = 0;
+    for (const auto& file : unused)
+    {
+        auto size = std::filesystem::file_size(file, ec);
+        if (std::filesystem::remove(file, ec))
+        {
+            freed += size;
+        }
+    }
+    return freed;
+}
+
+uint64_t usage(const std::filesystem::path& root)
+{
+    std::error_code ec;
+    uint64_t total = 0;
+    for (const auto& p :
+         std::filesystem::recursive_directory_iterator(root, ec))
+    {
+        if (p.is_regular_file(ec))
+        {
+            total += p.file_size(ec);
+        }
+    }
+    return total;
+}
+
+std::vector<std::filesystem::path> archives(const std::filesystem::path& dir)
+{
+    std::error_code ec;
+    std::vector<std::filesystem::path> list;
+    for (const auto& p : std::filesystem::directory_iterator(dir / dedupDir, ec))
+    {
+        auto name = p.path().filename();
+        if (p.is_regular_file(ec) && !name.string().starts_with('.'))
+        {
+            list.push_back(dir / name);
+        }
+    }
+    return list;
+}
+
+bool deduplicated(const std::filesystem::path& archive)
+{
+    std::error_code ec;
+    return !std::filesystem::exists(archive, ec) &&
+           std::filesystem::exists(manifestPath(archive), ec);
+}
+
+uint64_t size(const std::filesystem::path& archive)
+{
+    if (!deduplicated(archive))
+    {
+        return std::filesystem::file_size(archive);
+    }
+
+    uint64_t total = 0;
+    for (const auto& frame : readManifest(manifestPath(archive)))
+    {
+        total += frame.size;
+    }
+    return total;
+}
+
+Reader::Reader(const std::filesystem::path& archive)
+{
+    auto dir = archive.parent_path();
+    bool frames = deduplicated(archive);
+    if (frames)
+    {
+        dir = dir / dedupDir / framesDir;
+        for (const auto& frame : readManifest(manifestPath(archive)))
+        {
+            segments.push_back({frame.digest, total, frame.size});
+            total += frame.size;
+        }
+    }
+    else
+    {
+        segments.push_back({archive.filename(), 0, 0});
+    }
+
+    dirFD.emplace(open(dir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC));
+    if (((*dirFD)() < 0) || (!segments.empty() && !openSegment()))
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "Failed to open " + archive.string());
+    }
+
+    if (!frames)
+    {
+        struct stat fileStat;
+        if (fstat((*fd)(), &fileStat) < 0)
+        {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Failed to stat " + archive.string());
+        }
+        segments.front().size = fileStat.st_size;
+        total = fileStat.st_size;
+    }
+}
+
+bool Reader::openSegment()
+{
+    fd.emplace(openat((*dirFD)(), segments[current].name.c_str(),
+                      O_RDONLY | O_CLOEXEC));
+    if ((*fd)() < 0)
+    {
+        fd.reset();
+        return false;
+    }
+    return true;
+}
+
+void Reader::seek(uint64_t offset)
+{
+    offset = std::min(offset, total);
+    auto it = std::ranges::find_if(segments, [offset](const auto& segment) {
+        return offset < segment.start + segment.size;
+    });
+    auto index = (it == segments.end()) ? segments.size() : it - segments.begin();
+    if (index != current)
+    {
+        fd.reset();
+        current = index;
+    }
+    segmentOffset = (index < segments.size())
+                        ? offset - segments[index].start
+                        : 0;
+    position = offset;
+}
+
+ssize_t Reader::transfer(size_t count, const Transfer& op)
+{
+    while ((current < segments.size()) &&
+           (static_cast<uint64_t>(segmentOffset) == segments[current].size))
+    {
+        fd.reset();
+        current++;
+        segmentOffset = 0;
+    }
+    if (current == segments.size())
+    {
+        return 0;
+    }
+    if (!fd && !openSegment())
+    {
+        return -1;
+    }
+
+    count = std::min<uint64_t>(count,
+                               segments[current].size - segmentOffset);
+    auto moved = op((*fd)(), &segmentOffset, count);
+    if (moved > 0)
+    {
+        position += moved;
+    }
+    return moved;
+}
+
+} // namespace store
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "dump_digest.hpp"
+#include "dump_utils.hpp"
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace store
+{
+
+/** @brief Directory of a dump holding the manifests of its deduplicated
+ *  archives and the links to their frames.
+ */
+constexpr auto dedupDir = ".dedup";
+
+/** @brief Suffix of the frame index dreport writes next to an archive, as
+ *  .<archive name><frameIndexSuffix>.
+ */
+constexpr auto frameIndexSuffix = ".frames";
+
+/** @struct Frame
+ *  @brief Frame of a deduplicated archive
+ */
+struct Frame
+{
+    /** @brief SHA-256 digest of the frame, its name in the store */
+    std::string digest;
+
+    /** @brief Size of the frame in bytes */
+    uint64_t size;
+};
+
+/** @class Adder
+ *  @brief Moves the frames of an archive to the content addressed store,
+ *  a step at a time.
+ *  @details dreport run with deduplication lists the size and the SHA-256
+ *  digest of each compressed frame of the archive in its frame index. Each
+ *  frame is stored once in root, named after its digest, and hard linked
+ *  from the dedup directory of the dump: the link count of a stored frame
+ *  counts the dumps using it. Only the frames new to the store are copied,
+ *  a frame listed without a digest is hashed from the archive. The manifest
+ *  of the archive lists its frames in order, the archive and its frame index
+ *  are then removed. The archive is left as it is if it has no frame index
+ *  or if the frames can not be stored.
+ *
+ *  A step links a stored frame or hashes or copies at most a chunk of a
+ *  frame, so the dump manager runs the steps from an idle event source.
+ */
+class Adder
+{
+  public:
+    Adder() = delete;
+    Adder(const Adder&) = delete;
+    Adder& operator=(const Adder&) = delete;
+    Adder(Adder&&) = delete;
+    Adder& operator=(Adder&&) = delete;
+
+    /** @brief Remove the partial copy of a frame, if the archive is not
+     *  stored yet. The frames already linked stay in the store. */
+    ~Adder();
+
+    /** @brief Read the frame index of the archive
+     *  @param[in] root - Directory of the store.
+     *  @param[in] archive - Path of the archive.
+     */
+    Adder(const std::filesystem::path& root,
+          const std::filesystem::path& archive);
+
+    /** @brief Run the next step
+     *  @return true once the archive is stored or left as it is.
+     */
+    bool step();
+
+    /** @brief Whether the archive is only stored as frames now */
+    bool deduplicated() const
+    {
+        return stored;
+    }
+
+    /** @brief Size in bytes of the frames new to the store so far */
+    uint64_t newSize() const
+    {
+        return added;
+    }
+
+  private:
+    /** @brief Link the current frame, stored in the store, and move to the
+     *  next one */
+    void link(const std::filesystem::path& frame);
+
+    /** @brief Write the manifest and remove the archive */
+    void finish();
+
+    /** @brief Remove the frames stored for the archive, leaving it as it
+     *  is */
+    void fail(const std::exception& e);
+
+    /** @brief Directory of the store */
+    std::filesystem::path root;
+
+    /** @brief Path of the archive */
+    std::filesystem::path archive;
+
+    /** @brief Dedup directory of the dump */
+    std::filesystem::path dir;
+
+    /** @brief Frames of the archive in order */
+    std::vector<Frame> frames;
+
+    /** @brief Index of the current frame */
+    size_t current = 0;
+
+    /** @brief Offset of the current frame in the archive */
+    off_t offset = 0;
+
+    /** @brief Bytes of the current frame hashed or copied */
+    uint64_t done = 0;
+
+    /** @brief The archive, opened once the frame index is read */
+    std::optional<CustomFd> archiveFD;
+
+    /** @brief Partial copy of the current frame */
+    std::optional<CustomFd> tmpFD;
+
+    /** @brief Digest of the current frame, when it has to be hashed */
+    std::optional<digest::Hasher> hasher;
+
+    /** @brief Buffer of the data hashed */
+    std::vector<char> buffer;
+
+    /** @brief Frames new to the store */
+    std::vector<std::filesystem::path> newFrames;
+
+    /** @brief Size in bytes of the frames new to the store */
+    uint64_t added = 0;
+
+    /** @brief Whether the steps are over */
+    bool finished = false;
+
+    /** @brief Whether the archive is stored as frames */
+    bool stored = false;
+};
+
+/** @brief Move the frames of an archive to the content addressed store, at
+ *  once, see Adder.
+ *  @param[in] root - Directory of the store.
+ *  @param[in] archive - Path of the archive.
+ *  @return Size in bytes of the frames new to the store, std::nullopt if the
+ *  archive was not deduplicated.
+ */
+std::optional<uint64_t> add(const std::filesystem::path& root,
+                            const std::filesystem::path& archive);
+
+/** @class Owners
+ *  @brief Dumps using each stored frame.
+ *  @details The link count of a stored frame also counts the deleted dumps
+ *  the reaper did not remove yet. The owners only count the dumps still
+ *  listed, so the bytes freed by deleting a dump are known as soon as it is
+ *  deleted: the frames no other listed dump uses.
+ */
+class Owners
+{
+  public:
+    /** @brief Add the frames of a dump, from the manifests of its archives,
+     *  replacing the frames it had
+     *  @param[in] id - Id of the dump.
+     *  @param[in] dir - Directory of the dump.
+     *  @return Ids of the other dumps whose exclusive size changed.
+     */
+    std::vector<uint32_t> add(uint32_t id, const std::filesystem::path& dir);
+
+    /** @brief Remove the frames of a dump
+     *  @param[in] id - Id of the dump.
+     *  @return Ids of the other dumps whose exclusive size changed.
+     */
+    std::vector<uint32_t> remove(uint32_t id);
+
+    /** @brief Bytes of the frames no other dump uses
+     *  @param[in] id - Id of the dump.
+     */
+    uint64_t exclusive(uint32_t id) const;
+
+  private:
+    /** @struct Owned
+     *  @brief Stored frame and the dumps using it
+     */
+    struct Owned
+    {
+        /** @brief Size of the frame in bytes */
+        uint64_t size;
+
+        /** @brief Ids of the dumps using the frame */
+        std::set<uint32_t> ids;
+    };
+
+    /** @brief Frames used by the dumps, by digest */
+    std::map<std::string, Owned> frames;
+
+    /** @brief Digests of the frames of each dump */
+    std::map<uint32_t, std::set<std::string>> digests;
+};
+
+/** @brief Remove the stored frames no dump uses anymore
+ *  @param[in] root - Directory of the store.
+ *  @return Size in bytes of the removed frames.
+ */
+uint64_t collect(const std::filesystem::path& root);
+
+/** @brief Size of the stored frames
+ *  @param[in] root - Directory of the store.
+ *  @return Size in bytes of the frames in the store.
+ */
+uint64_t usage(const std::filesystem::path& root);
+
+/** @brief Deduplicated archives of a dump
+ *  @param[in] dir - Directory of the dump.
+ *  @return Paths the archives had in the dump directory.
+ */
+std::vector<std::filesystem::path> archives(const std::filesystem::path& dir);
+
+/** @brief Check whether an archive was deduplicated
+ *  @param[in] archive - Path of the archive.
+ *  @return true if the archive is only stored as frames.
+ */
+bool deduplicated(const std::filesystem::path& archive);
+
+/** @brief Size of an archive, deduplicated or not
+ *  @param[in] archive - Path of the archive.
+ *  @return Size of the archive in bytes.
+ *
+ *  @throws std::exception if the archive does not exist or its manifest can
+ *  not be read.
+ */
+uint64_t size(const std::filesystem::path& archive);
+
+/** @class Reader
+ *  @brief Sequential reader of a dump archive, deduplicated or not.
+ *  @details An archive which is not deduplicated is read from its file. A
+ *  deduplicated archive is read from the frame links of its dump, frame
+ *  after frame in the order of its manifest, it is never reassembled. The
+ *  bytes are moved by a transfer operation given the file descriptor and
+ *  the offset of the current frame, so the callers keep using sendfile()
+ *  or splice() without any copy.
+ */
+class Reader
+{
+  public:
+    /** @brief Transfer operation, moves up to count bytes from fd at offset
+     *  and advances offset, see sendfile() and splice().
+     *  @return The number of bytes moved, -1 with errno set on failure.
+     */
+    using Transfer = std::function<ssize_t(int fd, off_t* offset, size_t count)>;
+
+    Reader() = delete;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    Reader(Reader&&) = delete;
+    Reader& operator=(Reader&&) = delete;
+    ~Reader() = default;
+
+    /** @brief Open the archive, or its first frame if it was deduplicated.
+     *  @param[in] archive - Path of the archive.
+     *
+     *  @throws std::system_error if the archive can not be opened.
+     *  @throws std::runtime_error if the manifest can not be read.
+     */
+    explicit Reader(const std::filesystem::path& archive);
+
+    /** @brief Size of the archive in bytes */
+    uint64_t size() const
+    {
+        return total;
+    }
+
+    /** @brief Offset of the next byte to read */
+    uint64_t tell() const
+    {
+        return position;
+    }
+
+    /** @brief Move to an offset of the archive
+     *  @param[in] offset - Offset of the next byte to read, at most size().
+     */
+    void seek(uint64_t offset);
+
+    /** @brief Move the next bytes of the archive, within the current frame.
+     *  @param[in] count - Maximum number of bytes to move.
+     *  @param[in] op - Transfer operation.
+     *  @return The number of bytes moved, 0 at the end of the archive, -1
+     *  with errno set if the frame can not be opened or op failed.
+     */
+    ssize_t transfer(size_t count, const Transfer& op);
+
+  private:
+    /** @struct Segment
+     *  @brief Part of the archive stored in one file
+     */
+    struct Segment
+    {
+        /** @brief Name of the file in the directory of the reader */
+        std::string name;
+
+        /** @brief Offset of the segment in the archive */
+        uint64_t start;
+
+        /** @brief Size of the segment in bytes */
+        uint64_t size;
+    };
+
+    /** @brief Open the current segment */
+    bool openSegment();
+
+    /** @brief Directory the segments are opened from, it follows the dump
+     *  if its directory is renamed */
+    std::optional<CustomFd> dirFD;
+
+    /** @brief Segments of the archive in order */
+    std::vector<Segment> segments;
+
+    /** @brief Index of the current segment */
+    size_t current = 0;
+
+    /** @brief Current segment, opened on first use */
+    std::optional<CustomFd> fd;
+
+    /** @brief Offset of the next byte to read in the current segment */
+    off_t segmentOffset = 0;
+
+    /** @brief Offset of the next byte to read in the archive */
+    uint64_t position = 0;
+
+    /** @brief Size of the archive in bytes */
+    uint64_t total = 0;
+};
+
+} // namespace store
+} // namespace dump
+} // namespace phosphor
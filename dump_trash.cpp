@@ -0,0 +1,106 @@
+#include "dump_trash.hpp"
+
+#include <systemd/sd-event.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <vector>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace trash
+{
+
+/** @brief Number of files removed per event loop iteration */
+constexpr size_t reapBatch = 32;
+
+Reaper::Reaper(const sdeventplus::Event& event,
+               const std::filesystem::path& dir, Callback callback) :
+    dir(dir), callback(std::move(callback)),
+    source(event, [this](auto& /*source*/) { reapSome(); })
+{
+    source.set_priority(SD_EVENT_PRIORITY_IDLE);
+
+    std::error_code ec;
+    for (const auto& p : std::filesystem::directory_iterator(dir, ec))
+    {
+        queue.push_back(p.path().filename());
+    }
+    source.set_enabled(queue.empty() ? sdeventplus::source::Enabled::Off
+                                     : sdeventplus::source::Enabled::On);
+}
+
+std::string Reaper::move(const std::filesystem::path& path)
+{
+    std::filesystem::create_directories(dir);
+
+    auto name = path.filename().string();
+    for (int i = 1; std::filesystem::exists(dir / name); i++)
+    {
+        name = path.filename().string() + "." + std::to_string(i);
+    }
+    std::filesystem::rename(path, dir / name);
+
+    queue.push_back(name);
+    source.set_enabled(sdeventplus::source::Enabled::On);
+    return name;
+}
+
+void Reaper::reapSome()
+{
+    if (queue.empty())
+    {
+        source.set_enabled(sdeventplus::source::Enabled::Off);
+        return;
+    }
+
+    // Remove the files of the item a batch at a time, the directories are
+    // removed once they are empty
+    auto item = dir / queue.front();
+    std::error_code ec;
+    std::vector<std::filesystem::path> files;
+    for (auto it = std::filesystem::recursive_directory_iterator(item, ec);
+         (it != std::filesystem::recursive_directory_iterator()) &&
+         (files.size() < reapBatch);
+         it.increment(ec))
+    {
+        if (it->symlink_status(ec).type() !=
+            std::filesystem::file_type::directory)
+        {
+            files.push_back(it->path());
+        }
+    }
+
+    bool failed = false;
+    for (const auto& file : files)
+    {
+        if (!std::filesystem::remove(file, ec) && ec)
+        {
+            failed = true;
+        }
+    }
+    if (!failed && (files.size() == reapBatch))
+    {
+        return;
+    }
+
+    std::filesystem::remove_all(item, ec);
+    if (ec)
+    {
+        lg2::error("Failed to remove {PATH} from the trash, error: {ERROR}",
+                   "PATH", item, "ERROR", ec.message());
+    }
+    auto name = std::move(queue.front());
+    queue.pop_front();
+    if (queue.empty())
+    {
+        source.set_enabled(sdeventplus::source::Enabled::Off);
+    }
+    callback(name);
+}
+
+} // namespace trash
+} // namespace dump
+} // namespace phosphor
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/event.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace trash
+{
+
+/** @brief Directory of the trash, in the dump directory */
+constexpr auto trashDir = ".trash";
+
+/** @class Reaper
+ *  @brief Removes the deleted dumps in the background.
+ *  @details A deleted dump directory is renamed into the trash, which is
+ *  atomic and returns right away, and its files are removed by an idle
+ *  priority event source, a batch of files per event loop iteration, so the
+ *  D-Bus requests are served in between. The items left in the trash by a
+ *  previous run are removed too.
+ */
+class Reaper
+{
+  public:
+    /** @brief Called once an item of the trash is removed, with its name */
+    using Callback = std::function<void(const std::string&)>;
+
+    Reaper() = delete;
+    Reaper(const Reaper&) = delete;
+    Reaper& operator=(const Reaper&) = delete;
+    Reaper(Reaper&&) = delete;
+    Reaper& operator=(Reaper&&) = delete;
+    ~Reaper() = default;
+
+    /** @brief Constructor
+     *  @param[in] event - sd-event loop the files are removed from.
+     *  @param[in] dir - Directory of the trash.
+     *  @param[in] callback - Called once an item is removed.
+     */
+    Reaper(const sdeventplus::Event& event, const std::filesystem::path& dir,
+           Callback callback);
+
+    /** @brief Move a file or a directory to the trash.
+     *  @param[in] path - File or directory on the file system of the trash.
+     *  @return Name of the item in the trash.
+     *
+     *  @throws std::filesystem::filesystem_error if it can not be moved.
+     */
+    std::string move(const std::filesystem::path& path);
+
+    /** @brief Whether the trash is empty */
+    bool empty() const
+    {
+        return queue.empty();
+    }
+
+    /** @brief Directory of the trash */
+    const std::filesystem::path& path() const
+    {
+        return dir;
+    }
+
+  private:
+    /** @brief Remove a batch of files of the oldest item */
+    void reapSome();
+
+    /** @brief Directory of the trash */
+    std::filesystem::path dir;
+
+    /** @brief Called once an item is removed */
+    Callback callback;
+
+    /** @brief Names of the items, in the order they were moved */
+    std::deque<std::string> queue;
+
+    /** @brief Idle priority source removing the items */
+    sdeventplus::source::Defer source;
+};
+
+} // namespace trash
+} // namespace dump
+} // namespace phosphor
@@ -41,6 +41,53 @@ DUMP_TYPE_TO_STRING_MAP dumpTypeToStringMap = {
 % endfor
 };
 
+<%
+resource_keys = set()
+io_classes = {"realtime": 1, "best-effort": 2, "idle": 3}
+
+def optional(resources, key, quote=False):
+    if key not in resources:
+        return "std::nullopt"
+    if quote:
+        return '"' + str(resources[key]) + '"'
+    return str(resources[key])
+%>
+DUMP_TYPE_TO_RESOURCES_MAP dumpResourcesMap = {
+% for item in DUMP_TYPE_TABLE:
+  % for key, values in item.items():
+    % if len(values) > 2 and values[0].upper() not in resource_keys:
+<% res = values[2] %>\
+        {DumpTypes::${values[0].upper()},
+         {${optional(res, "cpu_weight")}, ${optional(res, "io_weight")},
+          ${optional(res, "memory_max", True)}, ${optional(res, "nice")},
+          ${str(io_classes[res["io_class"]]) if "io_class" in res else "std::nullopt"},
+          ${optional(res, "io_priority")}}},
+        <% resource_keys.add(values[0].upper()) %>
+    % endif
+  % endfor
+% endfor
+};
+
+<%
+archive_keys = set()
+archive_settings = ("compression", "compression_level", "compression_threads")
+%>
+DUMP_TYPE_TO_ARCHIVE_MAP dumpArchiveMap = {
+% for item in DUMP_TYPE_TABLE:
+  % for key, values in item.items():
+    % if len(values) > 2 and values[0].upper() not in archive_keys and \
+         any(setting in values[2] for setting in archive_settings):
+<% res = values[2] %>\
+        {DumpTypes::${values[0].upper()},
+         {"${res.get("compression", "xz")}",
+          ${optional(res, "compression_level")},
+          ${optional(res, "compression_threads")}}},
+        <% archive_keys.add(values[0].upper()) %>
+    % endif
+  % endfor
+% endfor
+};
+
 const ErrorMap errorMap = {
 % for key, errors in ERROR_TYPE_DICT.items():
     {"${key}", {
@@ -61,6 +108,26 @@ std::optional<std::string> dumpTypeToString(const DumpTypes& dumpType)
     return std::nullopt;
 }
 
+DumpResources getDumpResources(const DumpTypes& dumpType)
+{
+    auto it = dumpResourcesMap.find(dumpType);
+    if (it != dumpResourcesMap.end())
+    {
+        return it->second;
+    }
+    return {};
+}
+
+DumpArchive getDumpArchive(const DumpTypes& dumpType)
+{
+    auto it = dumpArchiveMap.find(dumpType);
+    if (it != dumpArchiveMap.end())
+    {
+        return it->second;
+    }
+    return {};
+}
+
 std::optional<DumpTypes> stringToDumpType(const std::string& str)
 {
     auto it = std::ranges::find_if(dumpTypeToStringMap,
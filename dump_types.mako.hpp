@@ -3,6 +3,7 @@
 // !!! WARNING: This is a GENERATED Code..Please do NOT Edit !!!
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <ranges>
 #include <string>
@@ -54,6 +55,42 @@ using DUMP_TYPE_TABLE =
 using DUMP_TYPE_TO_STRING_MAP =
     std::unordered_map<DumpTypes, DUMP_COLLECTION_TYPE>;
 
+// Resources granted to the collection of a dump type, the limits which
+// are not set are left to the system defaults.
+struct DumpResources
+{
+    // cpu.weight of the collection scope, 1 to 10000
+    std::optional<uint64_t> cpuWeight;
+    // io.weight of the collection scope, 1 to 10000
+    std::optional<uint64_t> ioWeight;
+    // memory.max of the collection scope, in systemd notation e.g. 64M
+    std::optional<std::string> memoryMax;
+    // Nice level of the collection, -20 to 19
+    std::optional<int> nice;
+    // I/O scheduling class of the collection, one of IOPRIO_CLASS_*
+    std::optional<int> ioClass;
+    // I/O scheduling priority within the class, 0 to 7
+    std::optional<int> ioPriority;
+};
+
+// Mapping between dump type and the resources of its collection
+using DUMP_TYPE_TO_RESOURCES_MAP =
+    std::unordered_map<DumpTypes, DumpResources>;
+
+// Archive format of the dumps of a dump type
+struct DumpArchive
+{
+    // Compression codec of the archive, "xz" or "zstd"
+    std::string codec = "xz";
+    // Compression level, the codec default when not set
+    std::optional<int> level;
+    // Compression threads, 0 for one per core, single threaded when not set
+    std::optional<int> threads;
+};
+
+// Mapping between dump type and the archive format of its dumps
+using DUMP_TYPE_TO_ARCHIVE_MAP = std::unordered_map<DumpTypes, DumpArchive>;
+
 /**
  * @brief Converts a DumpTypes enum value to dump name.
  *
@@ -62,6 +99,24 @@ using DUMP_TYPE_TO_STRING_MAP =
  */
 std::optional<std::string> dumpTypeToString(const DumpTypes& dumpType);
 
+/**
+ * @brief Gets the resources granted to the collection of a dump type.
+ *
+ * @param[in] dumpType The DumpTypes value to look up.
+ * @return Resources of the dump type, no limits are set if the dump type
+ * has no resources configured.
+ */
+DumpResources getDumpResources(const DumpTypes& dumpType);
+
+/**
+ * @brief Gets the archive format of the dumps of a dump type.
+ *
+ * @param[in] dumpType The DumpTypes value to look up.
+ * @return Archive format of the dump type, xz with the default settings if
+ * the dump type has no archive format configured.
+ */
+DumpArchive getDumpArchive(const DumpTypes& dumpType);
+
 /**
  * @brief Converts dump name to its corresponding DumpTypes enum value.
  *
@@ -0,0 +1,79 @@
+#include "config.h"
+
+#include "elog_rate_limit.hpp"
+
+#include <algorithm>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace elog
+{
+
+TokenBucket::TokenBucket(uint32_t burst, std::chrono::seconds interval,
+                         Clock::time_point now) :
+    burst(burst), interval(interval), tokens(burst), refillTime(now)
+{}
+
+bool TokenBucket::available(Clock::time_point now)
+{
+    if (interval.count() == 0)
+    {
+        return true;
+    }
+    if (tokens < burst)
+    {
+        auto gained = (now - refillTime) / interval;
+        if (gained > 0)
+        {
+            tokens = static_cast<uint32_t>(std::min<decltype(gained)>(
+                burst, tokens + gained));
+            refillTime += gained * interval;
+        }
+    }
+    else
+    {
+        refillTime = now;
+    }
+    return tokens > 0;
+}
+
+void TokenBucket::take()
+{
+    if ((interval.count() != 0) && (tokens > 0))
+    {
+        tokens--;
+    }
+}
+
+RateLimiter::RateLimiter(uint32_t burst, std::chrono::seconds interval,
+                         uint32_t typeBurst, std::chrono::seconds typeInterval,
+                         Clock::time_point now) :
+    global(burst, interval, now), typeBurst(typeBurst),
+    typeInterval(typeInterval)
+{}
+
+bool RateLimiter::allow(const std::string& errorType, Clock::time_point now)
+{
+    auto type = types.find(errorType);
+    if (type == types.end())
+    {
+        type =
+            types.emplace(errorType, TokenBucket(typeBurst, typeInterval, now))
+                .first;
+    }
+
+    // Take both tokens or none
+    if (!type->second.available(now) || !global.available(now))
+    {
+        return false;
+    }
+    type->second.take();
+    global.take();
+    return true;
+}
+
+} // namespace elog
+} // namespace dump
+} // namespace phosphor
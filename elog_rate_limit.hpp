@@ -0,0 +1,124 @@
+#pragma once
+
+#include "config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace phosphor
+{
+namespace dump
+{
+namespace elog
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** @class TokenBucket
+ *  @brief Token bucket limiting the rate of an event.
+ *  @details The bucket holds up to burst tokens and gains one every
+ *  interval, an event is allowed when it takes a token: a burst of events
+ *  passes, then one event per interval.
+ */
+class TokenBucket
+{
+  public:
+    TokenBucket() = delete;
+    ~TokenBucket() = default;
+    TokenBucket(const TokenBucket&) = default;
+    TokenBucket& operator=(const TokenBucket&) = default;
+    TokenBucket(TokenBucket&&) = default;
+    TokenBucket& operator=(TokenBucket&&) = default;
+
+    /** @brief Constructor of a full bucket.
+     *  @param[in] burst - Maximum number of tokens.
+     *  @param[in] interval - Time to gain a token, 0 for no limit.
+     *  @param[in] now - Current time.
+     */
+    TokenBucket(uint32_t burst, std::chrono::seconds interval,
+                Clock::time_point now);
+
+    /** @brief Whether the bucket holds a token
+     *  @param[in] now - Current time.
+     */
+    bool available(Clock::time_point now);
+
+    /** @brief Take a token, which must be available */
+    void take();
+
+  private:
+    /** @brief Maximum number of tokens */
+    uint32_t burst;
+
+    /** @brief Time to gain a token */
+    Clock::duration interval;
+
+    /** @brief Number of tokens held */
+    uint32_t tokens;
+
+    /** @brief Time the last token was gained at */
+    Clock::time_point refillTime;
+};
+
+/** @class RateLimiter
+ *  @brief Rate limits of the error log dumps.
+ *  @details A dump is triggered when both the bucket of its error type and
+ *  the global bucket hold a token, so a storm of one error does not starve
+ *  the dumps of the other errors and a storm of many errors is bounded too.
+ */
+class RateLimiter
+{
+  public:
+    ~RateLimiter() = default;
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+    RateLimiter(RateLimiter&&) = delete;
+    RateLimiter& operator=(RateLimiter&&) = delete;
+
+    /** @brief Constructor with the limits of the build configuration */
+    RateLimiter() :
+        RateLimiter(ELOG_DUMP_BURST,
+                    std::chrono::seconds(ELOG_DUMP_REFILL_INTERVAL),
+                    ELOG_DUMP_TYPE_BURST,
+                    std::chrono::seconds(ELOG_DUMP_TYPE_REFILL_INTERVAL),
+                    Clock::now())
+    {}
+
+    /** @brief Constructor
+     *  @param[in] burst - Dumps triggered in a burst.
+     *  @param[in] interval - Time to allow one more dump, 0 for no limit.
+     *  @param[in] typeBurst - Dumps of an error type triggered in a burst.
+     *  @param[in] typeInterval - Time to allow one more dump of an error
+     *                            type, 0 for no limit.
+     *  @param[in] now - Current time.
+     */
+    RateLimiter(uint32_t burst, std::chrono::seconds interval,
+                uint32_t typeBurst, std::chrono::seconds typeInterval,
+                Clock::time_point now);
+
+    /** @brief Take the tokens of a dump of the error type if available.
+     *  @param[in] errorType - Error type of the dump.
+     *  @param[in] now - Current time.
+     *  @return true if the dump can be triggered, false if it is suppressed.
+     */
+    bool allow(const std::string& errorType, Clock::time_point now);
+
+  private:
+    /** @brief Global bucket */
+    TokenBucket global;
+
+    /** @brief Dumps of an error type triggered in a burst */
+    uint32_t typeBurst;
+
+    /** @brief Time to allow one more dump of an error type */
+    std::chrono::seconds typeInterval;
+
+    /** @brief Buckets by error type */
+    std::map<std::string, TokenBucket> types;
+};
+
+} // namespace elog
+} // namespace dump
+} // namespace phosphor
@@ -4,6 +4,7 @@
 
 #include "dump_serialize.hpp"
 #include "dump_types.hpp"
+#include "xyz/openbmc_project/Common/error.hpp"
 #include "xyz/openbmc_project/Dump/Create/error.hpp"
 
 #include <cereal/cereal.hpp>
@@ -131,6 +132,18 @@ void Watch::addCallback(sdbusplus::message_t& msg)
         DumpIntr::convertDumpTypeToString(DumpType::ErrorLog);
     params[DumpIntr::convertCreateParametersToString(
         CreateParameters::ErrorType)] = errorType;
+
+    // An error collected in a pending dump of its type takes no token
+    if (!mgr.coalescing(errorType) &&
+        !rateLimiter.allow(errorType, Clock::now()))
+    {
+        lg2::info("Dump rate limit reached, no dump for the error log "
+                  "{PATH} of type {TYPE}",
+                  "PATH", objectPath, "TYPE", errorType);
+        mgr.dumpSuppressed(errorType);
+        return;
+    }
+
     try
     {
         // Save the elog information. This is to avoid dump requests
@@ -138,12 +151,20 @@ void Watch::addCallback(sdbusplus::message_t& msg)
         elogList.insert(eId);
 
         phosphor::dump::elog::serialize(elogList);
+
         mgr.Mgr::createDump(params);
     }
     catch (const QuotaExceeded& e)
     {
         // No action now
     }
+    catch (const sdbusplus::xyz::openbmc_project::Common::Error::Unavailable&
+               e)
+    {
+        lg2::error("Dump request queue is full, no dump for the error log "
+                   "{PATH}",
+                   "PATH", objectPath);
+    }
     return;
 }
 
@@ -3,6 +3,7 @@
 #include "config.h"
 
 #include "dump_manager_bmc.hpp"
+#include "elog_rate_limit.hpp"
 
 #include <cereal/access.hpp>
 #include <sdbusplus/bus.hpp>
@@ -27,6 +28,8 @@ using ElogList = std::set<EId>;
  *  @brief Adds d-bus signal based watch for elog add and delete.
  *  @details This implements methods for watching for InternalFailure
  *  type error message and call appropriate function to initiate dump
+ *  The dumps are rate limited by error type and globally, the number of
+ *  suppressed dumps is published on the dump manager object.
  */
 class Watch
 {
@@ -35,8 +38,8 @@ class Watch
     ~Watch() = default;
     Watch(const Watch&) = delete;
     Watch& operator=(const Watch&) = delete;
-    Watch(Watch&&) = default;
-    Watch& operator=(Watch&&) = default;
+    Watch(Watch&&) = delete;
+    Watch& operator=(Watch&&) = delete;
 
     /** @brief constructs watch for elog add and delete signals.
      *  @param[in] bus -  The Dbus bus object
@@ -96,6 +99,9 @@ class Watch
 
     /** @brief List of elog ids, which have associated dumps created */
     ElogList elogList;
+
+    /** @brief Rate limits of the dumps */
+    RateLimiter rateLimiter;
 };
 
 } // namespace elog
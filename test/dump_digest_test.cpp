@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <dump_digest.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using phosphor::dump::digest::Hasher;
+using phosphor::dump::digest::sha256;
+
+/** @brief SHA-256 of "abc", from FIPS 180-2 */
+constexpr auto abcDigest =
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+class TestDumpDigest : public ::testing::Test
+{
+  public:
+    void SetUp()
+    {
+        char tmpdir[] = "/tmp/dump.XXXXXX";
+        auto dirPtr = mkdtemp(tmpdir);
+        if (dirPtr == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        dumpDir = std::string(dirPtr);
+    }
+    void TearDown()
+    {
+        fs::remove_all(dumpDir);
+    }
+
+    fs::path dumpDir;
+};
+
+TEST_F(TestDumpDigest, FileKnownVector)
+{
+    auto file = dumpDir / "abc";
+    std::ofstream(file) << "abc";
+    EXPECT_EQ(sha256(file), abcDigest);
+}
+
+TEST_F(TestDumpDigest, Incremental)
+{
+    Hasher hasher;
+    hasher.update("a", 1);
+    hasher.update("bc", 2);
+    EXPECT_EQ(hasher.final(), abcDigest);
+}
+
+TEST_F(TestDumpDigest, EmptyFile)
+{
+    auto file = dumpDir / "empty";
+    std::ofstream(file).close();
+    EXPECT_EQ(sha256(file),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+TEST_F(TestDumpDigest, MissingFile)
+{
+    EXPECT_THROW(sha256(dumpDir / "missing"), std::runtime_error);
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <dump_job_queue.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using phosphor::dump::DumpTypes;
+using namespace phosphor::dump::bmc;
+using namespace std::chrono_literals;
+
+class TestJobQueue : public ::testing::Test
+{
+  public:
+    TestJobQueue() : jobs(2s), now(JobQueue::Clock::now()) {}
+
+    /** @brief Queue an error log dump */
+    void pushElog(uint32_t id, const std::string& errorType,
+                  const std::string& path)
+    {
+        jobs.push(jobs.make(id, DumpTypes::ELOG, errorType, JobPriority::Elog,
+                            path, now));
+    }
+
+    JobQueue jobs;
+    JobQueue::Clock::time_point now;
+};
+
+TEST_F(TestJobQueue, CoalesceSameErrorTypeInWindow)
+{
+    pushElog(1, "checkstop", "/log/1");
+    EXPECT_TRUE(jobs.coalescing("checkstop", now + 1s));
+    EXPECT_EQ(jobs.fold(DumpTypes::ELOG, "checkstop", JobPriority::Elog,
+                        "/log/2", now + 1s),
+              1);
+    EXPECT_EQ(jobs.size(), 1);
+
+    auto job = jobs.pop(now + 2s);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->id, 1);
+    EXPECT_EQ(job->paths, (std::vector<std::string>{"/log/1", "/log/2"}));
+}
+
+TEST_F(TestJobQueue, NoCoalesceOtherErrorType)
+{
+    pushElog(1, "checkstop", "/log/1");
+    EXPECT_FALSE(jobs.coalescing("internal", now + 1s));
+    EXPECT_EQ(jobs.fold(DumpTypes::ELOG, "internal", JobPriority::Elog,
+                        "/log/2", now + 1s),
+              std::nullopt);
+}
+
+TEST_F(TestJobQueue, NoCoalesceAfterWindow)
+{
+    pushElog(1, "checkstop", "/log/1");
+    EXPECT_FALSE(jobs.coalescing("checkstop", now + 2s));
+    EXPECT_EQ(jobs.fold(DumpTypes::ELOG, "checkstop", JobPriority::Elog,
+                        "/log/2", now + 2s),
+              std::nullopt);
+}
+
+TEST_F(TestJobQueue, FoldIdenticalRequest)
+{
+    jobs.push(jobs.make(1, DumpTypes::USER, "", JobPriority::User, "", now));
+    EXPECT_EQ(jobs.fold(DumpTypes::USER, "", JobPriority::User, "", now + 5s),
+              1);
+    EXPECT_EQ(jobs.fold(DumpTypes::CORE, "", JobPriority::Core, "", now + 5s),
+              std::nullopt);
+}
+
+TEST_F(TestJobQueue, PopPriorityAndWindow)
+{
+    pushElog(1, "checkstop", "/log/1");
+    jobs.push(jobs.make(2, DumpTypes::USER, "", JobPriority::User, "", now));
+    jobs.push(
+        jobs.make(3, DumpTypes::CORE, "", JobPriority::Core, "/core", now));
+
+    EXPECT_EQ(jobs.pop(now)->id, 3);
+    EXPECT_EQ(jobs.pop(now)->id, 2);
+    EXPECT_EQ(jobs.pop(now), std::nullopt);
+    EXPECT_EQ(jobs.nextStart(now), now + 2s);
+    EXPECT_EQ(jobs.pop(now + 2s)->id, 1);
+    EXPECT_EQ(jobs.size(), 0);
+}
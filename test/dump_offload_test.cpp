@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <dump_offload.hpp>
+
+#include <sdeventplus/event.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using phosphor::dump::offload::Scheduler;
+using phosphor::dump::offload::Session;
+using State = Session::State;
+
+class TestOffloadScheduler : public ::testing::Test
+{
+  public:
+    TestOffloadScheduler() : event(sdeventplus::Event::get_new()) {}
+
+    void SetUp()
+    {
+        char tmpdir[] = "/tmp/dump.XXXXXX";
+        auto dirPtr = mkdtemp(tmpdir);
+        if (dirPtr == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        dumpDir = std::string(dirPtr);
+        dumpFile = dumpDir / "obmcdump_1_1.tar.xz";
+        std::ofstream(dumpFile) << "dump";
+    }
+    void TearDown()
+    {
+        sessions.clear();
+        fs::remove_all(dumpDir);
+    }
+
+    /** @brief Queue a new session, its states are recorded in states */
+    void addSession()
+    {
+        auto index = states.size();
+        states.emplace_back();
+        sessions.push_back(std::make_unique<Session>(
+            event, dumpFile, 1, dumpDir / ("sock" + std::to_string(index)), 0,
+            *scheduler, [this, index](State state, const Session::Progress&) {
+                states[index].push_back(state);
+            }));
+    }
+
+    sdeventplus::Event event;
+    fs::path dumpDir;
+    fs::path dumpFile;
+    std::vector<std::vector<State>> states;
+    std::unique_ptr<Scheduler> scheduler;
+    std::vector<std::unique_ptr<Session>> sessions;
+};
+
+TEST_F(TestOffloadScheduler, Limit)
+{
+    scheduler = std::make_unique<Scheduler>(2);
+    addSession();
+    addSession();
+    addSession();
+
+    EXPECT_EQ(states[0], (std::vector{State::Queued, State::InProgress}));
+    EXPECT_EQ(states[1], (std::vector{State::Queued, State::InProgress}));
+    EXPECT_EQ(states[2], std::vector{State::Queued});
+}
+
+TEST_F(TestOffloadScheduler, FirstComeFirstServed)
+{
+    scheduler = std::make_unique<Scheduler>(1);
+    addSession();
+    addSession();
+    addSession();
+    EXPECT_EQ(states[1], std::vector{State::Queued});
+    EXPECT_EQ(states[2], std::vector{State::Queued});
+
+    sessions[0].reset();
+    EXPECT_EQ(states[1].back(), State::InProgress);
+    EXPECT_EQ(states[2], std::vector{State::Queued});
+
+    sessions[1].reset();
+    EXPECT_EQ(states[2].back(), State::InProgress);
+}
+
+TEST_F(TestOffloadScheduler, CancelQueued)
+{
+    scheduler = std::make_unique<Scheduler>(1);
+    addSession();
+    addSession();
+    addSession();
+
+    // The cancelled session never starts and does not hold a slot
+    sessions[1].reset();
+    sessions[0].reset();
+    EXPECT_EQ(states[1], std::vector{State::Queued});
+    EXPECT_EQ(states[2].back(), State::InProgress);
+}
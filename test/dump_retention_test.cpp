@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <dump_retention.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace phosphor::dump::retention;
+
+/** @brief Microseconds in a second */
+constexpr uint64_t second = 1000 * 1000;
+
+/** @brief Age limit of the user dumps in the example policy */
+constexpr uint64_t userMaxAge = 604800 * second;
+
+class TestDumpRetention : public ::testing::Test
+{
+  public:
+    TestDumpRetention() : engine(load("../example_retention.json")) {}
+
+    Engine engine;
+};
+
+TEST(TestRetentionPolicy, LoadExample)
+{
+    auto policy = load("../example_retention.json");
+    EXPECT_EQ(policy.order, Order::Oldest);
+    EXPECT_TRUE(policy.keepNotOffloaded);
+    ASSERT_EQ(policy.types.size(), 3);
+    EXPECT_EQ(policy.types["user"].rank, 0);
+    EXPECT_EQ(policy.types["user"].maxAge, std::chrono::seconds(604800));
+    EXPECT_EQ(policy.types["elog"].rank, 1);
+    EXPECT_EQ(policy.types["elog"].quota, 512 * 1024);
+    EXPECT_EQ(policy.types["core"].rank, 2);
+    EXPECT_TRUE(policy.types["core"].evict);
+}
+
+TEST(TestRetentionPolicy, LoadMissing)
+{
+    auto policy = load("missing_retention.json");
+    EXPECT_EQ(policy.order, Order::Oldest);
+    EXPECT_FALSE(policy.keepNotOffloaded);
+    EXPECT_TRUE(policy.types.empty());
+}
+
+TEST_F(TestDumpRetention, VictimLowestRankFirst)
+{
+    engine.set(1, {"core", 100, 10, true});
+    engine.set(2, {"elog", 200, 10, true});
+    engine.set(3, {"user", 300, 10, true});
+    engine.set(4, {"user", 50, 10, true});
+
+    EXPECT_EQ(engine.victim(), 3);
+    engine.remove(3);
+    EXPECT_EQ(engine.victim(), 4);
+    engine.remove(4);
+    EXPECT_EQ(engine.victim(), 2);
+    engine.remove(2);
+    EXPECT_EQ(engine.victim(), 1);
+    engine.remove(1);
+    EXPECT_EQ(engine.victim(), std::nullopt);
+}
+
+TEST_F(TestDumpRetention, VictimKeepsNotOffloaded)
+{
+    engine.set(1, {"user", 100, 10, false});
+    EXPECT_EQ(engine.victim(), std::nullopt);
+
+    engine.set(1, {"user", 100, 10, true});
+    EXPECT_EQ(engine.victim(), 1);
+}
+
+TEST_F(TestDumpRetention, VictimOverQuotaFirst)
+{
+    engine.set(1, {"user", 100, 10, true});
+    engine.set(2, {"elog", 200, 300 * 1024, true});
+    EXPECT_EQ(engine.victim(), 1);
+
+    engine.set(3, {"elog", 300, 300 * 1024, true});
+    EXPECT_EQ(engine.victim(), 2);
+}
+
+TEST(TestRetentionEngine, VictimLargestFirst)
+{
+    Policy policy;
+    policy.order = Order::Largest;
+    Engine engine(policy);
+    engine.set(1, {"user", 100, 10, true});
+    engine.set(2, {"user", 200, 30, true});
+    engine.set(3, {"user", 300, 20, true});
+    EXPECT_EQ(engine.victim(), 2);
+}
+
+TEST_F(TestDumpRetention, Expired)
+{
+    engine.set(1, {"user", 100, 10, true});
+    engine.set(2, {"user", 200, 10, true});
+    engine.set(3, {"core", 50, 10, true});
+
+    EXPECT_EQ(engine.nextExpiry(), 100 + userMaxAge + 1);
+    EXPECT_TRUE(engine.expired(100 + userMaxAge).empty());
+    EXPECT_EQ(engine.expired(100 + userMaxAge + 1), std::vector<uint32_t>{1});
+    EXPECT_EQ(engine.expired(200 + userMaxAge + 1),
+              (std::vector<uint32_t>{1, 2}));
+
+    engine.remove(1);
+    EXPECT_EQ(engine.nextExpiry(), 200 + userMaxAge + 1);
+    engine.remove(2);
+    EXPECT_EQ(engine.nextExpiry(), std::nullopt);
+}
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <unistd.h>
+
+#include <dump_digest.hpp>
+#include <dump_retention.hpp>
+#include <dump_store.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+namespace store = phosphor::dump::store;
+
+class TestDumpStore : public ::testing::Test
+{
+  public:
+    void SetUp()
+    {
+        char tmpdir[] = "/tmp/dump.XXXXXX";
+        auto dirPtr = mkdtemp(tmpdir);
+        if (dirPtr == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        dumpDir = std::string(dirPtr);
+        root = dumpDir / ".store";
+    }
+    void TearDown()
+    {
+        fs::remove_all(dumpDir);
+    }
+
+    /** @brief Write an archive made of frames and its frame index, the way
+     *  dreport does, or the way older versions of dreport did: without the
+     *  digests of the frames */
+    fs::path writeArchive(const std::string& id,
+                          const std::vector<std::string>& frames,
+                          bool digests = false)
+    {
+        auto dir = dumpDir / id;
+        fs::create_directories(dir);
+        auto archive = dir / ("obmcdump_" + id + ".tar.zst");
+        std::ofstream out(archive);
+        std::ofstream index(dir / ("." + archive.filename().string() +
+                                   store::frameIndexSuffix));
+        for (const auto& frame : frames)
+        {
+            out << frame;
+            index << frame.size();
+            if (digests)
+            {
+                phosphor::dump::digest::Hasher hasher;
+                hasher.update(frame.data(), frame.size());
+                index << " " << hasher.final();
+            }
+            index << "\n";
+        }
+        return archive;
+    }
+
+    /** @brief Read an archive from the current offset of a reader */
+    static std::string readAll(store::Reader& reader)
+    {
+        std::string data;
+        std::vector<char> buffer(4);
+        auto op = [&buffer](int fd, off_t* offset, size_t count) {
+            auto n = pread(fd, buffer.data(), std::min(count, buffer.size()),
+                           *offset);
+            if (n > 0)
+            {
+                *offset += n;
+            }
+            return n;
+        };
+        ssize_t n = 0;
+        while ((n = reader.transfer(buffer.size(), op)) > 0)
+        {
+            data.append(buffer.data(), n);
+        }
+        EXPECT_EQ(n, 0);
+        return data;
+    }
+
+    fs::path dumpDir;
+    fs::path root;
+};
+
+TEST_F(TestDumpStore, SharedFramesStoredOnce)
+{
+    auto first = writeArchive("1", {"aaaa", "bbbbbb"});
+    auto second = writeArchive("2", {"aaaa", "cc"});
+
+    EXPECT_EQ(store::add(root, first), 10);
+    EXPECT_EQ(store::add(root, second), 2);
+    EXPECT_EQ(store::usage(root), 12);
+    EXPECT_TRUE(store::deduplicated(first));
+    EXPECT_FALSE(fs::exists(first));
+    EXPECT_EQ(store::size(first), 10);
+    EXPECT_EQ(store::archives(first.parent_path()),
+              std::vector<fs::path>{first});
+
+    // The frames of the first dump only are released with it
+    EXPECT_EQ(store::collect(root), 0);
+    fs::remove_all(first.parent_path());
+    EXPECT_EQ(store::collect(root), 6);
+    EXPECT_EQ(store::usage(root), 6);
+
+    fs::remove_all(second.parent_path());
+    EXPECT_EQ(store::collect(root), 6);
+    EXPECT_EQ(store::usage(root), 0);
+}
+
+TEST_F(TestDumpStore, ReaderRoundTrip)
+{
+    auto archive = writeArchive("1", {"0123456789", "abc", "0123456789"});
+    ASSERT_TRUE(store::add(root, archive));
+
+    store::Reader reader(archive);
+    EXPECT_EQ(reader.size(), 23);
+    EXPECT_EQ(readAll(reader), "0123456789abc0123456789");
+    EXPECT_EQ(reader.tell(), 23);
+
+    // Resume within a frame
+    reader.seek(11);
+    EXPECT_EQ(readAll(reader), "bc0123456789");
+}
+
+TEST_F(TestDumpStore, ReaderPlainArchive)
+{
+    auto archive = writeArchive("1", {"plain", "archive"});
+    fs::remove(archive.parent_path() /
+               ("." + archive.filename().string() + store::frameIndexSuffix));
+
+    EXPECT_FALSE(store::add(root, archive));
+    EXPECT_FALSE(store::deduplicated(archive));
+
+    store::Reader reader(archive);
+    EXPECT_EQ(reader.size(), 12);
+    reader.seek(5);
+    EXPECT_EQ(readAll(reader), "archive");
+}
+
+TEST_F(TestDumpStore, InvalidFrameIndex)
+{
+    auto archive = writeArchive("1", {"frame"});
+    std::ofstream(archive, std::ios::app) << "trailing";
+
+    EXPECT_FALSE(store::add(root, archive));
+    EXPECT_TRUE(fs::exists(archive));
+    EXPECT_FALSE(store::deduplicated(archive));
+}
+
+TEST_F(TestDumpStore, FrameDigestsFromIndex)
+{
+    auto first = writeArchive("1", {"aaaa", "bbbbbb"}, true);
+    auto second = writeArchive("2", {"aaaa", "cc"}, true);
+
+    EXPECT_EQ(store::add(root, first), 10);
+    EXPECT_EQ(store::add(root, second), 2);
+    EXPECT_EQ(store::usage(root), 12);
+
+    // The frames are named after the digests of the index
+    phosphor::dump::digest::Hasher hasher;
+    hasher.update("aaaa", 4);
+    auto digest = hasher.final();
+    EXPECT_TRUE(fs::exists(root / digest.substr(0, 2) / digest));
+    EXPECT_EQ(fs::hard_link_count(root / digest.substr(0, 2) / digest), 3);
+
+    store::Reader reader(second);
+    EXPECT_EQ(readAll(reader), "aaaacc");
+}
+
+TEST_F(TestDumpStore, AdderSteps)
+{
+    // A frame larger than a chunk is hashed then copied over several steps
+    std::string large(300 * 1024, 'x');
+    auto archive = writeArchive("1", {large, "small"});
+
+    store::Adder adder(root, archive);
+    size_t steps = 0;
+    while (!adder.step())
+    {
+        steps++;
+        if (!adder.deduplicated())
+        {
+            EXPECT_TRUE(fs::exists(archive));
+        }
+    }
+    EXPECT_GT(steps, 6);
+    EXPECT_TRUE(adder.deduplicated());
+    EXPECT_EQ(adder.newSize(), large.size() + 5);
+    EXPECT_FALSE(fs::exists(archive));
+    EXPECT_EQ(store::size(archive), large.size() + 5);
+}
+
+TEST_F(TestDumpStore, AdderCancelled)
+{
+    std::string large(300 * 1024, 'x');
+    auto archive = writeArchive("1", {"small", large}, true);
+    {
+        store::Adder adder(root, archive);
+        EXPECT_FALSE(adder.step());
+        EXPECT_FALSE(adder.step());
+        EXPECT_EQ(adder.newSize(), 5);
+    }
+
+    // The archive is left as it is, the partial frame is removed
+    EXPECT_TRUE(fs::exists(archive));
+    EXPECT_FALSE(fs::exists(root / ".frame.tmp"));
+    EXPECT_EQ(store::usage(root), 5);
+}
+
+TEST_F(TestDumpStore, InvalidFrameDigest)
+{
+    auto archive = writeArchive("1", {"frame"});
+    std::ofstream(archive.parent_path() /
+                  ("." + archive.filename().string() +
+                   store::frameIndexSuffix))
+        << "5 ../../frame\n";
+
+    EXPECT_FALSE(store::add(root, archive));
+    EXPECT_TRUE(fs::exists(archive));
+    EXPECT_FALSE(store::deduplicated(archive));
+}
+
+TEST_F(TestDumpStore, OwnersExclusiveFrames)
+{
+    std::string shared(6000, 's');
+    auto first = writeArchive("1", {shared, "aaaa"}, true);
+    auto second = writeArchive("2", {shared, "bb"}, true);
+    ASSERT_TRUE(store::add(root, first));
+    ASSERT_TRUE(store::add(root, second));
+
+    store::Owners owners;
+    EXPECT_TRUE(owners.add(1, first.parent_path()).empty());
+    EXPECT_EQ(owners.exclusive(1), shared.size() + 4);
+
+    // The second dump shares the frame the first one had alone
+    EXPECT_EQ(owners.add(2, second.parent_path()),
+              std::vector<uint32_t>{1});
+    EXPECT_EQ(owners.exclusive(1), 4);
+    EXPECT_EQ(owners.exclusive(2), 2);
+
+    // Deleting a dump leaves the shared frame to the other one
+    EXPECT_EQ(owners.remove(1), std::vector<uint32_t>{2});
+    EXPECT_EQ(owners.exclusive(1), 0);
+    EXPECT_EQ(owners.exclusive(2), shared.size() + 2);
+    EXPECT_TRUE(owners.remove(1).empty());
+}
+
+TEST_F(TestDumpStore, RotateDeduplicatedDumps)
+{
+    // The dumps link to their frames only, their files take no space of
+    // their own, as for the manager with dump_dedup and rotate both on
+    std::string shared(6000, 's');
+    std::vector<fs::path> dumps{
+        writeArchive("1", {shared, std::string(1000, 'a')}, true),
+        writeArchive("2", {shared, std::string(1000, 'b')}, true),
+        writeArchive("3", {std::string(1000, 'c')}, true)};
+
+    phosphor::dump::retention::Engine retention(
+        phosphor::dump::retention::Policy{});
+    store::Owners owners;
+    uint64_t usage = 0;
+    for (uint32_t id = 1; id <= dumps.size(); id++)
+    {
+        usage += store::add(root, dumps[id - 1]).value_or(0);
+        owners.add(id, dumps[id - 1].parent_path());
+    }
+    for (uint32_t id = 1; id <= dumps.size(); id++)
+    {
+        retention.set(id, {"user", id, owners.exclusive(id), true});
+    }
+    EXPECT_EQ(usage, 9000);
+
+    // Make 2000 bytes free out of 10000, as makeSpace does: the oldest dump
+    // frees its own frame, which is enough
+    constexpr uint64_t total = 10000;
+    constexpr uint64_t needed = 2000;
+    uint64_t reclaimable = 0;
+    std::vector<uint32_t> evicted;
+    while (total - (usage - reclaimable) < needed)
+    {
+        auto victim = retention.victim();
+        ASSERT_TRUE(victim);
+        evicted.push_back(*victim);
+        retention.remove(*victim);
+        reclaimable += owners.exclusive(*victim);
+        for (auto id : owners.remove(*victim))
+        {
+            retention.set(id, {"user", id, owners.exclusive(id), true});
+        }
+    }
+    EXPECT_EQ(evicted, std::vector<uint32_t>{1});
+    EXPECT_EQ(owners.exclusive(2), 7000);
+
+    // The frames are freed once the dump is removed
+    fs::remove_all(dumps[0].parent_path());
+    EXPECT_EQ(store::collect(root), 1000);
+}
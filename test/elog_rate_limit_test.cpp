@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <elog_rate_limit.hpp>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace phosphor::dump::elog;
+using namespace std::chrono_literals;
+
+class TestRateLimit : public ::testing::Test
+{
+  public:
+    TestRateLimit() : now(Clock::now()) {}
+
+    Clock::time_point now;
+};
+
+TEST_F(TestRateLimit, BucketBurst)
+{
+    TokenBucket bucket(3, 10s, now);
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(bucket.available(now));
+        bucket.take();
+    }
+    EXPECT_FALSE(bucket.available(now));
+}
+
+TEST_F(TestRateLimit, BucketRefill)
+{
+    TokenBucket bucket(2, 10s, now);
+    bucket.take();
+    bucket.take();
+    EXPECT_FALSE(bucket.available(now + 9s));
+    EXPECT_TRUE(bucket.available(now + 10s));
+    bucket.take();
+    EXPECT_FALSE(bucket.available(now + 19s));
+
+    // Refilled up to the burst only
+    EXPECT_TRUE(bucket.available(now + 100s));
+    bucket.take();
+    bucket.take();
+    EXPECT_FALSE(bucket.available(now + 100s));
+}
+
+TEST_F(TestRateLimit, BucketNoLimit)
+{
+    TokenBucket bucket(1, 0s, now);
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_TRUE(bucket.available(now));
+        bucket.take();
+    }
+}
+
+TEST_F(TestRateLimit, TypeIsolation)
+{
+    RateLimiter limiter(10, 10s, 2, 60s, now);
+    EXPECT_TRUE(limiter.allow("checkstop", now));
+    EXPECT_TRUE(limiter.allow("checkstop", now));
+    EXPECT_FALSE(limiter.allow("checkstop", now));
+
+    // A storm of one error does not suppress the dumps of the others
+    EXPECT_TRUE(limiter.allow("internal", now));
+    EXPECT_TRUE(limiter.allow("checkstop", now + 60s));
+}
+
+TEST_F(TestRateLimit, GlobalLimit)
+{
+    RateLimiter limiter(2, 10s, 2, 60s, now);
+    EXPECT_TRUE(limiter.allow("a", now));
+    EXPECT_TRUE(limiter.allow("b", now));
+    EXPECT_FALSE(limiter.allow("c", now));
+
+    // A suppressed dump takes no token of its type
+    EXPECT_TRUE(limiter.allow("c", now + 10s));
+    EXPECT_TRUE(limiter.allow("c", now + 20s));
+    EXPECT_FALSE(limiter.allow("c", now + 30s));
+}
+
+TEST_F(TestRateLimit, NoLimit)
+{
+    RateLimiter limiter(1, 0s, 1, 0s, now);
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_TRUE(limiter.allow("checkstop", now));
+    }
+}